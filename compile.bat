@@ -17,6 +17,7 @@ set run=0
 set release=0
 set gdb=0
 set test=0
+set bench=0
 set verbose=0
 
 if not exist %build% (
@@ -32,6 +33,9 @@ for %%x in (%*) do (
         set release=1
     ) else if "%%x"=="test" (
         set test=1
+    ) else if "%%x"=="bench" (
+        set bench=1
+        set release=1
     ) else if "%%x"=="gdb" (
         set gdb=1
     ) else if "%%x"=="verbose" (
@@ -40,8 +44,9 @@ for %%x in (%*) do (
 )
 
 set "gcc_flags="
-if !release!==1 (set gcc_flags=!gcc_flags! -DNDEBUG) else (set gcc_flags=!gcc_flags! -g -DDEBUG)
+if !release!==1 (set gcc_flags=!gcc_flags! -O3 -flto -DNDEBUG) else (set gcc_flags=!gcc_flags! -O0 -g -DDEBUG)
 if !test!==1 (set gcc_flags=!gcc_flags! -DTEST)
+if !bench!==1 (set gcc_flags=!gcc_flags! -DBENCHMARK)
 if !verbose!==1 (set gcc_flags=!gcc_flags! -DVERBOSE)
 
 gcc ^
@@ -49,7 +54,6 @@ gcc ^
     %windows_wrapper_src% ^
     %main_src% ^
     -o%exe% ^
-    -O0 ^
     -Wall -Wextra -Wpedantic ^
     -std=c99 ^
     -I%raylib_include% ^
@@ -74,5 +78,6 @@ exit !errorlevel!
     echo    release     add asserts and debug symbols gcc
     echo    gdb         run gdb after compilation
     echo    test        executable will be set up to run tests
+    echo    bench       optimized executable that runs the synthesizer benchmarks
 exit 0
 
@@ -0,0 +1,146 @@
+#ifndef ARENA_C
+#define ARENA_C
+
+#define ARENA_ALIGNMENT 16
+#define ARENA_ALIGN(size) (((size) + ARENA_ALIGNMENT - 1) & ~(ARENA_ALIGNMENT - 1))
+
+typedef struct Arena_Chunk {
+    struct Arena_Chunk *next;
+    int capacity;
+    int used;
+} Arena_Chunk;
+
+#define ARENA_CHUNK_HEADER_SIZE ARENA_ALIGN((int)sizeof(Arena_Chunk))
+
+// bump allocations that all go at once. The chunks stay when the arena is reset, so a reset is O(1)
+// and the next use of about the same size takes nothing from the heap. Every chunk after the current
+// one is empty, whatever it held before the last reset or rewind is gone
+typedef struct Arena {
+    Dyn_Mem_Tag tag;
+    int chunk_size;
+    Arena_Chunk *first;
+    Arena_Chunk *current;
+    // arena_grow extends this one where it is when the chunk has room
+    void *last;
+} Arena;
+
+// where an arena was, rewinding to it frees everything allocated since
+typedef struct Arena_Mark {
+    Arena_Chunk *chunk;
+    int used;
+} Arena_Mark;
+
+inline static char *arena_chunk_data(Arena_Chunk *chunk) {
+    return (char *)chunk + ARENA_CHUNK_HEADER_SIZE;
+}
+
+static void arena_init(Arena *arena, Dyn_Mem_Tag tag, int chunk_size) {
+    *arena = (Arena){0};
+    arena->tag = tag;
+    arena->chunk_size = chunk_size;
+}
+
+static void *arena_alloc(Arena *arena, int size) {
+    size = ARENA_ALIGN(size);
+    Arena_Chunk *previous = NULL;
+    Arena_Chunk *chunk = arena->current;
+    while (chunk != NULL && chunk->used + size > chunk->capacity) {
+        previous = chunk;
+        chunk = chunk->next;
+        if (chunk != NULL) {
+            chunk->used = 0;
+        }
+    }
+    if (chunk == NULL) {
+        int capacity = size > arena->chunk_size ? size : arena->chunk_size;
+        chunk = (Arena_Chunk *)dyn_mem_alloc_tagged(ARENA_CHUNK_HEADER_SIZE + capacity, arena->tag);
+        if (chunk == NULL) {
+            return NULL;
+        }
+        chunk->next = NULL;
+        chunk->capacity = capacity;
+        chunk->used = 0;
+        if (previous != NULL) {
+            previous->next = chunk;
+        } else {
+            arena->first = chunk;
+        }
+    }
+    void *m = arena_chunk_data(chunk) + chunk->used;
+    chunk->used += size;
+    arena->current = chunk;
+    arena->last = m;
+    return m;
+}
+
+static void *arena_alloc_zero(Arena *arena, int size) {
+    void *m = arena_alloc(arena, size);
+    if (m != NULL) {
+        memset(m, 0, size);
+    }
+    return m;
+}
+
+// the arena's realloc, the old block stays in the arena until it is reset when it has to move
+static void *arena_grow(Arena *arena, void *m, int old_size, int new_size) {
+    if (m != NULL && m == arena->last) {
+        Arena_Chunk *chunk = arena->current;
+        int offset = (int)((char *)m - arena_chunk_data(chunk));
+        if (offset + ARENA_ALIGN(new_size) <= chunk->capacity) {
+            chunk->used = offset + ARENA_ALIGN(new_size);
+            return m;
+        }
+    }
+    void *grown = arena_alloc(arena, new_size);
+    if (grown != NULL && m != NULL) {
+        memcpy(grown, m, old_size < new_size ? old_size : new_size);
+    }
+    return grown;
+}
+
+// makes room for count elements, doubling from 16 like the heap arrays
+static void arena_reserve(Arena *arena, void **data, int *capacity, int count, int element_size) {
+    if (count <= *capacity) {
+        return;
+    }
+    int new_capacity = *capacity == 0 ? 16 : *capacity * 2;
+    while (new_capacity < count) {
+        new_capacity *= 2;
+    }
+    *data = arena_grow(arena, *data, *capacity * element_size, new_capacity * element_size);
+    if (*data == NULL) {
+        thread_error();
+    }
+    *capacity = new_capacity;
+}
+
+static Arena_Mark arena_mark(Arena *arena) {
+    return (Arena_Mark){
+        .chunk = arena->current,
+        .used = arena->current != NULL ? arena->current->used : 0,
+    };
+}
+
+static void arena_rewind(Arena *arena, Arena_Mark mark) {
+    arena->current = mark.chunk != NULL ? mark.chunk : arena->first;
+    if (arena->current != NULL) {
+        arena->current->used = mark.chunk != NULL ? mark.used : 0;
+    }
+    arena->last = NULL;
+}
+
+static void arena_reset(Arena *arena) {
+    arena_rewind(arena, (Arena_Mark){0});
+}
+
+static void arena_free(Arena *arena) {
+    Arena_Chunk *chunk = arena->first;
+    while (chunk != NULL) {
+        Arena_Chunk *next = chunk->next;
+        dyn_mem_release_tagged(chunk, arena->tag);
+        chunk = next;
+    }
+    arena_init(arena, arena->tag, arena->chunk_size);
+}
+
+#endif
@@ -0,0 +1,382 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "main.h"
+#include "windows_wrapper.h"
+
+// a sample is one synthesized frame, the channels are copies of it.
+// Allocations are the heap allocations after the first batch or run, once the caches and pools are warm
+typedef struct Benchmark_Result {
+    const char *suite;
+    const char *name;
+    Oscillator_Mode oscillator_mode;
+    Waveform waveform;
+    int chord_size;
+    int note;
+    int bpm;
+    long long tone_count;
+    long long frame_count;
+    double seconds;
+    long long peak_bytes;
+    long long allocations;
+    float cache_hit_rate;
+} Benchmark_Result;
+
+typedef struct Benchmark_Options {
+    bool is_json;
+    const char *output_path;
+    double min_seconds;
+    float max_program_seconds;
+    const char *suite;
+    int sample_rate;
+} Benchmark_Options;
+
+typedef struct Benchmark {
+    Benchmark_Options options;
+    FILE *output;
+    int result_count;
+} Benchmark;
+
+static const char *benchmark_waveform_names[WAVEFORM_COUNT] = { "none", "sine", "triangle", "square", "sawtooth" };
+static const int benchmark_notes[] = { 64, 32, 16, 8, 4, 2, 1 };
+static const int benchmark_bpms[] = { 60, 120, 240 };
+
+static void benchmark_print_usage(const char *exe) {
+    fprintf(stderr, "%s [options]\n", exe);
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "   -f csv|json   output format (default: csv)\n");
+    fprintf(stderr, "   -o <file>     write the results to this file (default: stdout)\n");
+    fprintf(stderr, "   -t <secs>     minimum time spent on each workload (default: 0.25)\n");
+    fprintf(stderr, "   -s <secs>     stop programs after this many seconds of audio (default: %d)\n", HEADLESS_DEFAULT_MAX_SECONDS);
+    fprintf(stderr, "   -w <suite>    only run one suite: chords, durations, programs or notes\n");
+    fprintf(stderr, "   -r <hz>       render at this sample rate (default: %d)\n", SYNTHESIZER_DEFAULT_SAMPLE_RATE);
+}
+
+static bool benchmark_parse_options(int argc, char **argv, Benchmark_Options *options) {
+    *options = (Benchmark_Options) {
+        .is_json = false,
+        .output_path = NULL,
+        .min_seconds = 0.25,
+        .max_program_seconds = HEADLESS_DEFAULT_MAX_SECONDS,
+        .suite = NULL,
+        .sample_rate = SYNTHESIZER_DEFAULT_SAMPLE_RATE,
+    };
+    for (int i = 1; i < argc; i++) {
+        bool has_value = (i + 1) < argc;
+        if (strcmp(argv[i], "-f") == 0 && has_value) {
+            options->is_json = strcmp(argv[++i], "json") == 0;
+        } else if (strcmp(argv[i], "-o") == 0 && has_value) {
+            options->output_path = argv[++i];
+        } else if (strcmp(argv[i], "-t") == 0 && has_value) {
+            options->min_seconds = atof(argv[++i]);
+        } else if (strcmp(argv[i], "-s") == 0 && has_value) {
+            options->max_program_seconds = (float)atof(argv[++i]);
+        } else if (strcmp(argv[i], "-w") == 0 && has_value) {
+            options->suite = argv[++i];
+        } else if (strcmp(argv[i], "-r") == 0 && has_value) {
+            options->sample_rate = atoi(argv[++i]);
+            if (options->sample_rate < SYNTHESIZER_MIN_SAMPLE_RATE || options->sample_rate > SYNTHESIZER_MAX_SAMPLE_RATE) {
+                return false;
+            }
+        } else {
+            return false;
+        }
+    }
+    return true;
+}
+
+static bool benchmark_should_run(Benchmark *benchmark, const char *suite) {
+    return benchmark->options.suite == NULL || strcmp(benchmark->options.suite, suite) == 0;
+}
+
+static void benchmark_report(Benchmark *benchmark, Benchmark_Result *r) {
+    double samples_per_second = r->seconds > 0.0 ? (double)r->frame_count / r->seconds : 0.0;
+    double ns_per_sample = r->frame_count > 0 ? r->seconds * 1e9 / (double)r->frame_count : 0.0;
+    const char *mode = r->oscillator_mode == OSCILLATOR_MODE_WAVETABLE ? "wavetable" : "formula";
+    const char *waveform = benchmark_waveform_names[r->waveform];
+    FILE *out = benchmark->output;
+
+    if (benchmark->options.is_json) {
+        fprintf(
+            out,
+            "%s\n    {\"suite\": \"%s\", \"name\": \"%s\", \"oscillator_mode\": \"%s\", \"waveform\": \"%s\", "
+            "\"chord_size\": %d, \"note\": %d, \"bpm\": %d, \"tones\": %lld, \"samples\": %lld, \"seconds\": %.6f, "
+            "\"samples_per_second\": %.0f, \"ns_per_sample\": %.3f, \"peak_bytes\": %lld, \"allocations\": %lld, \"cache_hit_rate\": %.4f}",
+            benchmark->result_count == 0 ? "[" : ",",
+            r->suite, r->name, mode, waveform,
+            r->chord_size, r->note, r->bpm, r->tone_count, r->frame_count, r->seconds,
+            samples_per_second, ns_per_sample, r->peak_bytes, r->allocations, r->cache_hit_rate
+        );
+    } else {
+        if (benchmark->result_count == 0) {
+            fprintf(out, "suite,name,oscillator_mode,waveform,chord_size,note,bpm,tones,samples,seconds,samples_per_second,ns_per_sample,peak_bytes,allocations,cache_hit_rate\n");
+        }
+        fprintf(
+            out,
+            "%s,%s,%s,%s,%d,%d,%d,%lld,%lld,%.6f,%.0f,%.3f,%lld,%lld,%.4f\n",
+            r->suite, r->name, mode, waveform,
+            r->chord_size, r->note, r->bpm, r->tone_count, r->frame_count, r->seconds,
+            samples_per_second, ns_per_sample, r->peak_bytes, r->allocations, r->cache_hit_rate
+        );
+    }
+    fflush(out);
+    benchmark->result_count++;
+}
+
+// renders batches of distinct tones until min_seconds have passed, with the tone cache turned off
+static void benchmark_tones(Benchmark *benchmark, Synthesizer *synthesizer, Benchmark_Result *r) {
+    Tone tones[SYNTHESIZER_TONE_CAPACITY] = {0};
+    for (int i = 0; i < SYNTHESIZER_TONE_CAPACITY; i++) {
+        tones[i].waveform = r->waveform;
+        tones[i].chord.size = r->chord_size;
+        for (int j = 0; j < r->chord_size; j++) {
+            tones[i].chord.frequencies[j] = 110.0f * powf(2.0f, (float)(i + 3 * j) / 12.0f);
+        }
+        tones[i].duration = 240.0f / (float)(r->note * r->bpm);
+    }
+
+    synthesizer->oscillator_mode = r->oscillator_mode;
+    synthesizer->tone_cache.max_entries = 0;
+    // the blocks pooled by the workload before are no part of this one's peak
+    pcm_pool_free(&synthesizer->tone_cache.pool);
+    dyn_mem_reset_peak();
+    long long base_bytes = dyn_mem_current_bytes;
+    long long warm_allocations = -1;
+
+    double start_time = get_time_seconds();
+    do {
+        if (warm_allocations < 0 && r->tone_count > 0) {
+            warm_allocations = dyn_mem_allocation_count;
+        }
+        Synthesizer_Sound sounds[SYNTHESIZER_TONE_CAPACITY];
+        synthesizer_render_tones(synthesizer, tones, SYNTHESIZER_TONE_CAPACITY, sounds);
+        for (int i = 0; i < SYNTHESIZER_TONE_CAPACITY; i++) {
+            // tones too long to be rendered ahead are only generated when they are played
+            headless_play_sound(synthesizer, &sounds[i], sounds[i].frame_count, NULL);
+            r->frame_count += sounds[i].frame_count;
+            synthesizer_sound_release(synthesizer, &sounds[i]);
+        }
+        r->tone_count += SYNTHESIZER_TONE_CAPACITY;
+        r->seconds = get_time_seconds() - start_time;
+    } while (r->seconds < benchmark->options.min_seconds);
+
+    r->peak_bytes = dyn_mem_peak_bytes - base_bytes;
+    r->allocations = warm_allocations < 0 ? 0 : dyn_mem_allocation_count - warm_allocations;
+    benchmark_report(benchmark, r);
+}
+
+static void benchmark_chords(Benchmark *benchmark, Synthesizer *synthesizer) {
+    for (int mode = OSCILLATOR_MODE_WAVETABLE; mode <= OSCILLATOR_MODE_FORMULA; mode++) {
+        for (int waveform = WAVEFORM_SINE; waveform < WAVEFORM_COUNT; waveform++) {
+            for (int chord_size = 1; chord_size <= OCTAVE; chord_size++) {
+                Benchmark_Result r = {
+                    .suite = "chords", .name = "",
+                    .oscillator_mode = mode, .waveform = waveform,
+                    .chord_size = chord_size, .note = 4, .bpm = 120,
+                };
+                benchmark_tones(benchmark, synthesizer, &r);
+            }
+        }
+    }
+}
+
+static void benchmark_durations(Benchmark *benchmark, Synthesizer *synthesizer) {
+    for (int waveform = WAVEFORM_SINE; waveform < WAVEFORM_COUNT; waveform++) {
+        for (size_t b = 0; b < sizeof(benchmark_bpms) / sizeof(benchmark_bpms[0]); b++) {
+            for (size_t n = 0; n < sizeof(benchmark_notes) / sizeof(benchmark_notes[0]); n++) {
+                Benchmark_Result r = {
+                    .suite = "durations", .name = "",
+                    .oscillator_mode = OSCILLATOR_MODE_WAVETABLE, .waveform = waveform,
+                    .chord_size = 3, .note = benchmark_notes[n], .bpm = benchmark_bpms[b],
+                };
+                benchmark_tones(benchmark, synthesizer, &r);
+            }
+        }
+    }
+}
+
+// compiles and renders the whole program, over and over until min_seconds have passed, with the tone cache on
+static void benchmark_program(Benchmark *benchmark, Synthesizer *synthesizer, const char *path) {
+    DynArray lines;
+    if (!headless_load_lines(path, &lines)) {
+        fprintf(stderr, "Could not open \"%s\"\n", path);
+        return;
+    }
+    Compiler *compiler = (Compiler *)dyn_mem_alloc_zero(sizeof(Compiler));
+    compiler_init(compiler);
+
+    synthesizer->oscillator_mode = OSCILLATOR_MODE_WAVETABLE;
+    synthesizer->tone_cache.max_entries = TONE_CACHE_DEFAULT_MAX_ENTRIES;
+    synthesizer->tone_cache.hits = 0;
+    synthesizer->tone_cache.misses = 0;
+    long long max_frames = (long long)(benchmark->options.max_program_seconds * synthesizer->format.sample_rate);
+
+    Benchmark_Result r = {
+        .suite = "programs", .name = path,
+        .oscillator_mode = OSCILLATOR_MODE_WAVETABLE, .waveform = WAVEFORM_NONE,
+    };
+    // every run starts from an empty cache, so its entries are part of the peak
+    tone_cache_clear(&synthesizer->tone_cache);
+    pcm_pool_free(&synthesizer->tone_cache.pool);
+    dyn_mem_reset_peak();
+    long long base_bytes = dyn_mem_current_bytes;
+    long long warm_allocations = -1;
+
+    double start_time = get_time_seconds();
+    do {
+        if (warm_allocations < 0 && r.frame_count > 0) {
+            warm_allocations = dyn_mem_allocation_count;
+        }
+        tone_cache_clear(&synthesizer->tone_cache);
+        compiler_start(compiler, &lines);
+        if (compiler->error_type != NO_ERROR) {
+            fprintf(stderr, "%s: %s\n", path, compiler->error_message);
+            break;
+        }
+        Headless_Result result = headless_render(synthesizer, compiler, max_frames, -1, NULL);
+        compiler_reset(compiler);
+        r.tone_count += result.tone_count;
+        r.frame_count += result.frame_count;
+        r.seconds = get_time_seconds() - start_time;
+    } while (r.seconds < benchmark->options.min_seconds);
+
+    if (compiler->error_type == NO_ERROR) {
+        r.peak_bytes = dyn_mem_peak_bytes - base_bytes;
+        r.allocations = warm_allocations < 0 ? 0 : dyn_mem_allocation_count - warm_allocations;
+        r.cache_hit_rate = tone_cache_hit_rate(&synthesizer->tone_cache);
+        benchmark_report(benchmark, &r);
+    }
+
+    tone_cache_clear(&synthesizer->tone_cache);
+    compiler_free(compiler);
+    dyn_mem_release(compiler);
+    headless_free_lines(&lines);
+}
+
+static void benchmark_programs(Benchmark *benchmark, Synthesizer *synthesizer) {
+    char filenames[BENCHMARK_MAX_PROGRAMS * (EDITOR_FILENAME_MAX_LENGTH + 1)];
+    if (list_files(PROGRAMS_DIRECTORY "/*.txt", filenames, BENCHMARK_MAX_PROGRAMS) != 0) {
+        fprintf(stderr, "Could not list \"%s\"\n", PROGRAMS_DIRECTORY);
+        return;
+    }
+    char *filename = strtok(filenames, "\n");
+    while (filename != NULL) {
+        char path[EDITOR_FILENAME_MAX_LENGTH + sizeof(PROGRAMS_DIRECTORY) + 1];
+        snprintf(path, sizeof(path), "%s/%s", PROGRAMS_DIRECTORY, filename);
+        benchmark_program(benchmark, synthesizer, path);
+        filename = strtok(NULL, "\n");
+    }
+}
+
+// the parser's note lookups before the tables, kept here as the baseline they are measured against
+static float benchmark_frequency_powf(int note) {
+    return A4_FREQ * powf(2.0f, (float)note / (float)OCTAVE);
+}
+
+static int benchmark_transpose_walk(int note, int scale, int direction, int steps) {
+    for (int i = 0; i < steps; i++) {
+        note += direction;
+        while (!has_flag(scale, get_note_flag(note))) {
+            note += direction;
+        }
+    }
+    return note;
+}
+
+typedef enum Benchmark_Note_Workload {
+    BENCHMARK_FREQUENCY_POWF,
+    BENCHMARK_FREQUENCY_TABLE,
+    BENCHMARK_TRANSPOSE_WALK,
+    BENCHMARK_TRANSPOSE_TABLE,
+    BENCHMARK_NOTE_WORKLOAD_COUNT,
+} Benchmark_Note_Workload;
+
+static const char *benchmark_note_workload_names[BENCHMARK_NOTE_WORKLOAD_COUNT] = {
+    "frequency_powf", "frequency_table", "transpose_walk", "transpose_table",
+};
+
+// a sample is one note looked up or transposed, the notes and steps are what programs do between plays
+static void benchmark_note_lookups(Benchmark *benchmark) {
+    // chromatic, a minor, a harmonic minor and a minor pentatonic, as masks starting at a
+    static const int scales[] = { 0xfff, 0x5ad, 0x9ad, 0x4a9 };
+    enum { OPERATION_COUNT = 4096 };
+    static int notes[OPERATION_COUNT];
+    static int operation_scales[OPERATION_COUNT];
+    static int steps[OPERATION_COUNT];
+    uint32 random = 1;
+    for (int i = 0; i < OPERATION_COUNT; i++) {
+        random = random * 1664525u + 1013904223u;
+        notes[i] = MIN_NOTE + (int)((random >> 8) % (MAX_NOTE - MIN_NOTE + 1));
+        operation_scales[i] = scales[(random >> 4) % (sizeof(scales) / sizeof(scales[0]))];
+        steps[i] = 1 + (int)((random >> 20) % 8);
+    }
+    note_tables_init();
+
+    for (int workload = 0; workload < BENCHMARK_NOTE_WORKLOAD_COUNT; workload++) {
+        Benchmark_Result r = {
+            .suite = "notes", .name = benchmark_note_workload_names[workload],
+            .oscillator_mode = OSCILLATOR_MODE_WAVETABLE, .waveform = WAVEFORM_NONE,
+        };
+        volatile float sink = 0.0f;
+        double start_time = get_time_seconds();
+        do {
+            float sum = 0.0f;
+            for (int i = 0; i < OPERATION_COUNT; i++) {
+                int direction = (i & 1) ? 1 : -1;
+                switch (workload) {
+                case BENCHMARK_FREQUENCY_POWF:  sum += benchmark_frequency_powf(notes[i]); break;
+                case BENCHMARK_FREQUENCY_TABLE: sum += note_frequency(notes[i]); break;
+                case BENCHMARK_TRANSPOSE_WALK:  sum += benchmark_transpose_walk(notes[i], operation_scales[i], direction, steps[i]); break;
+                case BENCHMARK_TRANSPOSE_TABLE: sum += note_transpose(notes[i], operation_scales[i], direction, steps[i]); break;
+                }
+            }
+            sink += sum;
+            r.frame_count += OPERATION_COUNT;
+            r.seconds = get_time_seconds() - start_time;
+        } while (r.seconds < benchmark->options.min_seconds);
+        benchmark_report(benchmark, &r);
+    }
+}
+
+int benchmark_run(int argc, char **argv) {
+    Benchmark benchmark = {0};
+    if (!benchmark_parse_options(argc, argv, &benchmark.options)) {
+        benchmark_print_usage(argv[0]);
+        return 1;
+    }
+    benchmark.output = stdout;
+    if (benchmark.options.output_path != NULL) {
+        benchmark.output = fopen(benchmark.options.output_path, "w");
+        if (benchmark.output == NULL) {
+            fprintf(stderr, "Could not write \"%s\"\n", benchmark.options.output_path);
+            return 1;
+        }
+    }
+
+    Synthesizer synthesizer = {0};
+    Audio_Format format = AUDIO_FORMAT_DEFAULT;
+    format.sample_rate = benchmark.options.sample_rate;
+    synthesizer_init_offline(&synthesizer, format);
+
+    if (benchmark_should_run(&benchmark, "chords")) {
+        benchmark_chords(&benchmark, &synthesizer);
+    }
+    if (benchmark_should_run(&benchmark, "durations")) {
+        benchmark_durations(&benchmark, &synthesizer);
+    }
+    if (benchmark_should_run(&benchmark, "programs")) {
+        benchmark_programs(&benchmark, &synthesizer);
+    }
+    if (benchmark_should_run(&benchmark, "notes")) {
+        benchmark_note_lookups(&benchmark);
+    }
+
+    if (benchmark.options.is_json) {
+        fprintf(benchmark.output, benchmark.result_count > 0 ? "\n]\n" : "[]\n");
+    }
+    if (benchmark.output != stdout) {
+        fclose(benchmark.output);
+    }
+    synthesizer_free_offline(&synthesizer);
+    return 0;
+}
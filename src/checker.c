@@ -0,0 +1,178 @@
+#include <string.h>
+
+#include "main.h"
+#include "windows_wrapper.h"
+
+static bool checker_lines_equal(DynArray *a, DynArray *b) {
+    return a->length == b->length && memcmp(a->data, b->data, a->length) == 0;
+}
+
+static void checker_lines_free(DynArray *lines) {
+    for (int i = 0; i < lines->length; i++) {
+        dyn_array_release(dyn_array_get(lines, i));
+    }
+    dyn_array_release(lines);
+}
+
+// copies the lines over the ones already there, so a copy after every pause in typing reuses their memory
+static void checker_lines_copy(DynArray *to, DynArray *from) {
+    while (to->length > from->length) {
+        dyn_array_release(dyn_array_get(to, to->length - 1));
+        to->length--;
+    }
+    for (int i = 0; i < from->length; i++) {
+        if (i == to->length) {
+            DynArray line;
+            dyn_array_alloc(&line, sizeof(char));
+            dyn_array_push(to, &line);
+        }
+        DynArray *from_line = dyn_array_get(from, i);
+        DynArray *to_line = dyn_array_get(to, i);
+        if (from_line->length > to_line->capacity) {
+            dyn_array_expand(to_line, from_line->length);
+        }
+        memcpy(to_line->data, from_line->data, from_line->length);
+        to_line->length = from_line->length;
+    }
+}
+
+// swaps the snapshot in for the lines checked last. Only the lines between the unchanged ones
+// at the start and at the end are lexed again, which covers typing as well as pasting lines
+static void checker_take_snapshot(Checker *checker) {
+    DynArray *old_lines = &checker->lines;
+    DynArray *new_lines = &checker->snapshot;
+
+    int common = old_lines->length < new_lines->length ? old_lines->length : new_lines->length;
+    int prefix = 0;
+    while (prefix < common && checker_lines_equal(dyn_array_get(old_lines, prefix), dyn_array_get(new_lines, prefix))) {
+        prefix++;
+    }
+    int suffix = 0;
+    while (
+        suffix < common - prefix &&
+        checker_lines_equal(
+            dyn_array_get(old_lines, old_lines->length - 1 - suffix),
+            dyn_array_get(new_lines, new_lines->length - 1 - suffix)
+        )
+    ) {
+        suffix++;
+    }
+    lex_cache_lines_removed(&checker->lex_cache, prefix, old_lines->length - prefix - suffix);
+    lex_cache_lines_inserted(&checker->lex_cache, prefix, new_lines->length - prefix - suffix);
+
+    DynArray swap = *old_lines;
+    *old_lines = *new_lines;
+    *new_lines = swap;
+    checker->has_snapshot = false;
+}
+
+static void checker_thread(void *data) {
+    Checker *checker = (Checker *)data;
+    Compiler *c = &checker->compiler;
+    while (true) {
+        event_wait(checker->work_available);
+
+        mutex_lock(checker->mutex);
+            if (checker->should_quit) {
+                mutex_unlock(checker->mutex);
+                return;
+            }
+            bool has_snapshot = checker->has_snapshot;
+            uint32 revision = checker->snapshot_revision;
+            if (has_snapshot) {
+                checker_take_snapshot(checker);
+            }
+        mutex_unlock(checker->mutex);
+
+        if (!has_snapshot) {
+            continue;
+        }
+
+        Checker_Result result = { .revision = revision, .error_type = NO_ERROR, .line_number = -1 };
+        if (!compiler_check(c, &checker->lines)) {
+            result.error_type = c->error_type;
+            result.line_number = c->line_number;
+            result.char_idx = c->char_idx;
+            snprintf(result.summary, sizeof(result.summary), "%s", error_description(c->error_type));
+            for (int i = 0; result.summary[i] != '\0'; i++) {
+                if (result.summary[i] == '\n') {
+                    result.summary[i] = ' ';
+                }
+            }
+        }
+        compiler_reset(c);
+
+        mutex_lock(checker->mutex);
+            // newer lines are already waiting, this result is stale before anyone sees it
+            if (!checker->has_snapshot) {
+                checker->result = result;
+                checker->has_result = true;
+            }
+        mutex_unlock(checker->mutex);
+    }
+}
+
+void checker_init(Checker *checker) {
+    checker->mutex = mutex_create();
+    checker->work_available = event_create();
+    compiler_init(&checker->compiler);
+    checker->compiler.lex_cache = &checker->lex_cache;
+    dyn_array_alloc(&checker->lines, sizeof(DynArray));
+    dyn_array_alloc(&checker->snapshot, sizeof(DynArray));
+    checker->thread = thread_create(checker_thread, checker);
+    if (checker->thread == NULL) {
+        exit(1);
+    }
+}
+
+void checker_free(Checker *checker) {
+    mutex_lock(checker->mutex);
+        checker->should_quit = true;
+    mutex_unlock(checker->mutex);
+    event_signal(checker->work_available);
+    thread_join(checker->thread);
+
+    compiler_free(&checker->compiler);
+    lex_cache_free(&checker->lex_cache);
+    checker_lines_free(&checker->lines);
+    checker_lines_free(&checker->snapshot);
+    mutex_destroy(checker->mutex);
+    event_destroy(checker->work_available);
+}
+
+// called every frame with the editor's lines and the revision of their lex cache,
+// copies the lines for the checker thread once they stopped changing for a moment
+void checker_update(Checker *checker, DynArray *lines, uint32 revision, float delta_time) {
+    if (revision != checker->seen_revision) {
+        checker->seen_revision = revision;
+        checker->idle_seconds = 0.0f;
+        return;
+    }
+    if (revision == checker->submitted_revision) {
+        return;
+    }
+    checker->idle_seconds += delta_time;
+    if (checker->idle_seconds < CHECKER_DEBOUNCE_SECONDS) {
+        return;
+    }
+
+    mutex_lock(checker->mutex);
+        checker_lines_copy(&checker->snapshot, lines);
+        checker->snapshot_revision = revision;
+        checker->has_snapshot = true;
+    mutex_unlock(checker->mutex);
+    event_signal(checker->work_available);
+    checker->submitted_revision = revision;
+}
+
+// true when a check finished since the last call, its result is copied out
+bool checker_poll(Checker *checker, Checker_Result *result) {
+    mutex_lock(checker->mutex);
+        bool has_result = checker->has_result;
+        if (has_result) {
+            *result = checker->result;
+            checker->has_result = false;
+        }
+    mutex_unlock(checker->mutex);
+    return has_result;
+}
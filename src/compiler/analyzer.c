@@ -0,0 +1,391 @@
+#ifndef ANALYZER_C
+#define ANALYZER_C
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../main.h"
+#include "compiler_utils.c"
+
+// follows the bytecode like the parser, but only what decides how much is played: bpm, chord size,
+// whether a start is still being sought and the loop and return stacks. Notes never change any of that.
+// A repeat round that ends in the state it started in plays the same again until the next round
+// a "rounds" could pick out, so those are counted instead of run. Arriving at the start of a forever
+// loop or of a define jumped back to in the same state as last time means it repeats from there.
+// Still seeking then, or at the end, the start is never reached and like the parser it begins again without
+
+typedef struct Analyzer_Round {
+    int bpm;
+    int chord_size;
+    bool is_seeking;
+    long long tone_count;
+    long long frame_count;
+    // tones of the rounds right before this one that all started in the same state
+    long long repeated_tone_count;
+} Analyzer_Round;
+
+typedef struct Analyzer_Visit {
+    bool is_loop_head;
+    bool is_visited;
+    int bpm;
+    int chord_size;
+    bool is_seeking;
+    Repetition *loops;
+    int loop_count;
+    int loop_capacity;
+    int *returns;
+    int return_count;
+    int return_capacity;
+    long long tone_count;
+    long long frame_count;
+} Analyzer_Visit;
+
+// everything but the parser's stacks is taken from the compiler's arena and goes back when the analysis is done
+typedef struct Analyzer {
+    Arena *arena;
+    Parser parser;
+    Analyzer_Round *rounds;
+    int round_capacity;
+    // one per instruction, only the targets of jumps back use theirs
+    Analyzer_Visit *visits;
+    // every round number any "rounds" mentions, sorted and counted from 0
+    int *special_rounds;
+    int special_round_count;
+    long long window_bytes[SYNTHESIZER_RING_DEFAULT_DEPTH];
+    int window_idx;
+    long long window_sum;
+    bool is_periodic;
+    long long periodic_tone_count;
+    long long periodic_frame_count;
+    Analysis analysis;
+} Analyzer;
+
+static int analyzer_compare_ints(const void *a, const void *b) {
+    return (*(const int *)a > *(const int *)b) - (*(const int *)a < *(const int *)b);
+}
+
+// the first round at or after this one that a "rounds" could pick out, INT_MAX when there is none
+static int analyzer_next_special_round(Analyzer *a, int round) {
+    int low = 0;
+    int high = a->special_round_count;
+    while (low < high) {
+        int middle = low + (high - low) / 2;
+        if (a->special_rounds[middle] < round) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low < a->special_round_count ? a->special_rounds[low] : INT_MAX;
+}
+
+static void analyzer_emit(Analyzer *a, float duration, int chord_size) {
+    Analysis *analysis = &a->analysis;
+    int frame_count = duration_frame_count(duration, SYNTHESIZER_DEFAULT_SAMPLE_RATE);
+    analysis->tone_count++;
+    analysis->frame_count += frame_count;
+    if (chord_size > analysis->max_chord_size) {
+        analysis->max_chord_size = chord_size;
+    }
+
+    // longer tones are generated while they play, only their ring of blocks is queued
+    long long bytes = frame_count > SYNTHESIZER_MAX_RENDERED_FRAMES ? SYNTHESIZER_AHEAD_BLOCKS * SYNTHESIZER_BLOCK_FRAMES * sizeof(float) : (long long)frame_count * sizeof(float);
+    a->window_sum += bytes - a->window_bytes[a->window_idx];
+    a->window_bytes[a->window_idx] = bytes;
+    a->window_idx = (a->window_idx + 1) % SYNTHESIZER_RING_DEFAULT_DEPTH;
+    if (a->window_sum > analysis->peak_lookahead_bytes) {
+        analysis->peak_lookahead_bytes = a->window_sum;
+    }
+}
+
+static bool analyzer_visit_matches(Analyzer_Visit *visit, Parser *parser) {
+    return
+        visit->is_visited &&
+        visit->bpm == parser->current_bpm &&
+        visit->chord_size == parser->current_chord.size &&
+        visit->is_seeking == parser->is_seeking &&
+        visit->loop_count == parser->loop_count &&
+        visit->return_count == parser->return_count &&
+        (parser->loop_count == 0 || memcmp(visit->loops, parser->loops, sizeof(Repetition) * parser->loop_count) == 0) &&
+        (parser->return_count == 0 || memcmp(visit->returns, parser->returns, sizeof(int) * parser->return_count) == 0);
+}
+
+static void analyzer_visit_save(Analyzer *a, Analyzer_Visit *visit) {
+    Parser *parser = &a->parser;
+    arena_reserve(a->arena, (void **)&visit->loops, &visit->loop_capacity, parser->loop_count, sizeof(Repetition));
+    arena_reserve(a->arena, (void **)&visit->returns, &visit->return_capacity, parser->return_count, sizeof(int));
+    visit->is_visited = true;
+    visit->bpm = parser->current_bpm;
+    visit->chord_size = parser->current_chord.size;
+    visit->is_seeking = parser->is_seeking;
+    visit->loop_count = parser->loop_count;
+    visit->return_count = parser->return_count;
+    for (int i = 0; i < parser->loop_count; i++) {
+        visit->loops[i] = parser->loops[i];
+    }
+    for (int i = 0; i < parser->return_count; i++) {
+        visit->returns[i] = parser->returns[i];
+    }
+    visit->tone_count = a->analysis.tone_count;
+    visit->frame_count = a->analysis.frame_count;
+}
+
+// the whole state decides what comes next, so the first loop head that finds it the same as on its
+// last visit has found the period. True once that has gone on long enough for every window of the lookahead
+static bool analyzer_arrive_at_loop_head(Analyzer *a, Analyzer_Visit *visit) {
+    Analysis *analysis = &a->analysis;
+    if (!a->is_periodic) {
+        if (!analyzer_visit_matches(visit, &a->parser)) {
+            analyzer_visit_save(a, visit);
+            return false;
+        }
+        a->is_periodic = true;
+        a->periodic_tone_count = visit->tone_count;
+        a->periodic_frame_count = visit->frame_count;
+        analysis->period_tone_count = analysis->tone_count - visit->tone_count;
+        analysis->period_frame_count = analysis->frame_count - visit->frame_count;
+    }
+    if (analysis->tone_count - a->periodic_tone_count < SYNTHESIZER_RING_DEFAULT_DEPTH + analysis->period_tone_count) {
+        return false;
+    }
+    analysis->length = ANALYSIS_LENGTH_FOREVER;
+    analysis->tone_count = a->periodic_tone_count;
+    analysis->frame_count = a->periodic_frame_count;
+    return true;
+}
+
+static void analyzer_restart(Analyzer *a, int instruction_count) {
+    parser_init(&a->parser, false);
+    for (int i = 0; i < instruction_count; i++) {
+        a->visits[i].is_visited = false;
+    }
+}
+
+static Analysis analyzer_run(Compiler *compiler) {
+    Bytecode *code = &compiler->bytecode;
+    Instruction *instructions = code->instructions;
+
+    Arena *arena = &compiler->arena;
+    Arena_Mark mark = arena_mark(arena);
+    Analyzer *a = (Analyzer *)arena_alloc_zero(arena, sizeof(Analyzer));
+    if (a == NULL) {
+        thread_error();
+    }
+    a->arena = arena;
+    a->visits = (Analyzer_Visit *)arena_alloc_zero(arena, sizeof(Analyzer_Visit) * code->instruction_count);
+    if (a->visits == NULL) {
+        thread_error();
+    }
+    if (code->round_number_count > 0) {
+        a->special_rounds = (int *)arena_alloc(arena, sizeof(int) * code->round_number_count);
+        if (a->special_rounds == NULL) {
+            thread_error();
+        }
+        for (int i = 0; i < code->round_number_count; i++) {
+            a->special_rounds[i] = code->round_numbers[i] - 1;
+        }
+        qsort(a->special_rounds, code->round_number_count, sizeof(int), analyzer_compare_ints);
+        for (int i = 0; i < code->round_number_count; i++) {
+            if (a->special_round_count == 0 || a->special_rounds[a->special_round_count - 1] != a->special_rounds[i]) {
+                a->special_rounds[a->special_round_count++] = a->special_rounds[i];
+            }
+        }
+    }
+
+    for (int i = 0; i < code->instruction_count; i++) {
+        if (instructions[i].opcode == OP_JUMP && instructions[i].as.target <= i) {
+            a->visits[instructions[i].as.target].is_loop_head = true;
+        }
+    }
+
+    Parser *parser = &a->parser;
+    parser_init(parser, code->has_start);
+    Analysis *analysis = &a->analysis;
+    analysis->length = ANALYSIS_LENGTH_UNKNOWN;
+
+    int pc = 0;
+    for (int step = 0; step < ANALYZER_MAX_STEPS; step++) {
+        if (a->visits[pc].is_loop_head) {
+            if (parser->is_seeking && analyzer_visit_matches(&a->visits[pc], parser)) {
+                analyzer_restart(a, code->instruction_count);
+                pc = 0;
+                continue;
+            }
+            if (analyzer_arrive_at_loop_head(a, &a->visits[pc])) {
+                break;
+            }
+        }
+        Instruction *instruction = &instructions[pc++];
+        switch (instruction->opcode) {
+        default:
+            ASSERT(false);
+            break;
+        case OP_HALT: {
+            if (parser->is_seeking) {
+                analyzer_restart(a, code->instruction_count);
+                pc = 0;
+                break;
+            }
+            analysis->length = ANALYSIS_LENGTH_FINITE;
+        } break;
+        case OP_EMIT_TONE: {
+            if (!parser->is_seeking) {
+                float duration = instruction->as.tone.duration * 240.0f / parser->current_bpm;
+                analyzer_emit(a, duration, instruction->as.tone.is_play ? parser->current_chord.size : 0);
+            }
+        } break;
+        case OP_START: {
+            parser->is_seeking = false;
+        } break;
+        case OP_SET_WAVEFORM:
+        case OP_TRANSPOSE:
+        case OP_SET_SCALE: {
+        } break;
+        case OP_SET_BPM: {
+            parser->current_bpm = instruction->as.number;
+        } break;
+        case OP_SET_NOTE: {
+            parser->current_chord.size = 1;
+        } break;
+        case OP_SET_CHORD: {
+            parser->current_chord.size = code->chords[instruction->as.number].size;
+        } break;
+        case OP_LOOP: {
+            if (parser->loop_count == parser->loop_capacity) {
+                parser_stack_grow((void **)&parser->loops, &parser->loop_capacity, sizeof(Repetition));
+            }
+            arena_reserve(arena, (void **)&a->rounds, &a->round_capacity, parser->loop_capacity, sizeof(Analyzer_Round));
+            parser->loops[parser->loop_count] = (Repetition){
+                .target = instruction->as.number,
+                .round = 0,
+            };
+            a->rounds[parser->loop_count++] = (Analyzer_Round){
+                .bpm = parser->current_bpm,
+                .chord_size = parser->current_chord.size,
+                .is_seeking = parser->is_seeking,
+                .tone_count = analysis->tone_count,
+                .frame_count = analysis->frame_count,
+                .repeated_tone_count = 0,
+            };
+        } break;
+        case OP_END_LOOP: {
+            Repetition *rep = &parser->loops[parser->loop_count - 1];
+            Analyzer_Round *round = &a->rounds[parser->loop_count - 1];
+            long long round_tone_count = analysis->tone_count - round->tone_count;
+            long long round_frame_count = analysis->frame_count - round->frame_count;
+            bool is_repeated =
+                round->bpm == parser->current_bpm &&
+                round->chord_size == parser->current_chord.size &&
+                round->is_seeking == parser->is_seeking &&
+                analyzer_next_special_round(a, rep->round) != rep->round;
+            round->repeated_tone_count = is_repeated ? round->repeated_tone_count + round_tone_count : 0;
+            rep->round++;
+
+            // only skipped once the lookahead has seen every window of the repetition
+            if (
+                is_repeated &&
+                (round_tone_count == 0 || round->repeated_tone_count >= SYNTHESIZER_RING_DEFAULT_DEPTH + round_tone_count)
+            ) {
+                int next_special_round = analyzer_next_special_round(a, rep->round);
+                int end_round = next_special_round < rep->target ? next_special_round : rep->target;
+                if (end_round > rep->round) {
+                    long long skipped = end_round - rep->round;
+                    analysis->tone_count += skipped * round_tone_count;
+                    analysis->frame_count += skipped * round_frame_count;
+                    rep->round = end_round;
+                }
+            }
+
+            if (rep->round < rep->target) {
+                pc = instruction->as.target;
+                round->tone_count = analysis->tone_count;
+                round->frame_count = analysis->frame_count;
+            } else {
+                parser->loop_count--;
+            }
+        } break;
+        case OP_ROUNDS: {
+            int round = parser->loop_count > 0 ? parser->loops[parser->loop_count - 1].round : -1;
+            int *round_numbers = &code->round_numbers[instruction->as.rounds.first];
+            bool special_round = false;
+            for (int j = 0; j < instruction->as.rounds.count; j++) {
+                if ((round_numbers[j] - 1) == round) {
+                    special_round = true;
+                    break;
+                }
+            }
+            if (!special_round) {
+                pc = instruction->as.rounds.end;
+            }
+        } break;
+        case OP_JUMP: {
+            pc = instruction->as.target;
+        } break;
+        case OP_CALL: {
+            if (parser->return_count == ANALYZER_MAX_CALL_DEPTH) {
+                step = ANALYZER_MAX_STEPS;
+                break;
+            }
+            if (parser->return_count == parser->return_capacity) {
+                parser_stack_grow((void **)&parser->returns, &parser->return_capacity, sizeof(int));
+            }
+            parser->returns[parser->return_count++] = pc;
+            pc = instruction->as.target;
+        } break;
+        case OP_RET: {
+            pc = parser->returns[--parser->return_count];
+        } break;
+        }
+        if (analysis->length == ANALYSIS_LENGTH_FINITE) {
+            break;
+        }
+    }
+
+    Analysis result = *analysis;
+    parser_free(parser);
+    arena_rewind(arena, mark);
+    return result;
+}
+
+// one line per fact, for the console and the headless tools
+static void analysis_format(Analysis *analysis, char *buffer, int buffer_size) {
+    double seconds = (double)analysis->frame_count / SYNTHESIZER_DEFAULT_SAMPLE_RATE;
+    double period_seconds = (double)analysis->period_frame_count / SYNTHESIZER_DEFAULT_SAMPLE_RATE;
+    double lookahead_kb = (double)analysis->peak_lookahead_bytes / 1024.0;
+    switch (analysis->length) {
+    case ANALYSIS_LENGTH_FINITE: {
+        snprintf(
+            buffer, buffer_size,
+            "Length: %.2fs, %lld tones\nLargest chord: %d\nPeak lookahead: %.0f KiB",
+            seconds, analysis->tone_count, analysis->max_chord_size, lookahead_kb
+        );
+    } break;
+    case ANALYSIS_LENGTH_FOREVER: {
+        if (analysis->tone_count == 0) {
+            snprintf(
+                buffer, buffer_size,
+                "Length: forever\nRepeats every %.2fs, %lld tones\nLargest chord: %d\nPeak lookahead: %.0f KiB",
+                period_seconds, analysis->period_tone_count, analysis->max_chord_size, lookahead_kb
+            );
+            break;
+        }
+        snprintf(
+            buffer, buffer_size,
+            "Length: forever, %.2fs and %lld tones before repeating\n"
+            "Repeats every %.2fs, %lld tones\nLargest chord: %d\nPeak lookahead: %.0f KiB",
+            seconds, analysis->tone_count, period_seconds, analysis->period_tone_count,
+            analysis->max_chord_size, lookahead_kb
+        );
+    } break;
+    case ANALYSIS_LENGTH_UNKNOWN: {
+        snprintf(
+            buffer, buffer_size,
+            "Length: unknown, still changing after %.2fs and %lld tones\nLargest chord: %d",
+            seconds, analysis->tone_count, analysis->max_chord_size
+        );
+    } break;
+    }
+}
+
+#endif
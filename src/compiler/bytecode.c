@@ -0,0 +1,259 @@
+#ifndef BYTECODE_C
+#define BYTECODE_C
+
+#include "../main.h"
+#include "compiler_utils.c"
+
+#define BYTECODE_INITIAL_CAPACITY 256
+
+// lowers the validated tokens once, so the parser only has to run a flat list of instructions:
+// loops carry their own counters, calls their resolved targets and "rounds" its list of numbers,
+// nothing has to look back at the tokens to find out what a ")" closes
+typedef enum Bytecode_Block {
+    BLOCK_REPEAT,
+    BLOCK_FOREVER,
+    BLOCK_ROUNDS,
+    BLOCK_DEFINE,
+} Bytecode_Block;
+
+typedef struct Bytecode_Open_Block {
+    Bytecode_Block block;
+    int address;
+} Bytecode_Open_Block;
+
+static void bytecode_reserve(Arena *arena, void **data, int *capacity, int count, int element_size) {
+    if (count < *capacity) {
+        return;
+    }
+    int old_capacity = *capacity;
+    *capacity = *capacity == 0 ? BYTECODE_INITIAL_CAPACITY : *capacity * 2;
+    *data = arena_grow(arena, *data, old_capacity * element_size, *capacity * element_size);
+    if (*data == NULL) {
+        thread_error();
+    }
+}
+
+static Instruction *bytecode_add(Arena *arena, Bytecode *code, Opcode opcode) {
+    bytecode_reserve(arena, (void **)&code->instructions, &code->instruction_capacity, code->instruction_count, sizeof(Instruction));
+    Instruction *instruction = &code->instructions[code->instruction_count++];
+    *instruction = (Instruction){0};
+    instruction->opcode = opcode;
+    return instruction;
+}
+
+static int bytecode_add_chord(Arena *arena, Bytecode *code, Chord chord) {
+    bytecode_reserve(arena, (void **)&code->chords, &code->chord_capacity, code->chord_count, sizeof(Chord));
+    code->chords[code->chord_count] = chord;
+    return code->chord_count++;
+}
+
+static void bytecode_add_round_number(Arena *arena, Bytecode *code, int round_number) {
+    bytecode_reserve(arena, (void **)&code->round_numbers, &code->round_number_capacity, code->round_number_count, sizeof(int));
+    code->round_numbers[code->round_number_count++] = round_number;
+}
+
+// whether a start can run at all, following every way on from the top of the program: calls into the
+// defines they target, loops and "rounds" both into and past their bodies. A start in a define nothing
+// calls must not make the parser seek, it would skip the whole program looking for it
+static bool bytecode_reaches_start(Arena *arena, Bytecode *code) {
+    Arena_Mark mark = arena_mark(arena);
+    bool *is_reached = (bool *)arena_alloc_zero(arena, sizeof(bool) * code->instruction_count);
+    int *pending = (int *)arena_alloc(arena, sizeof(int) * code->instruction_count);
+    if (is_reached == NULL || pending == NULL) {
+        thread_error();
+    }
+
+    int pending_count = 0;
+    bool has_start = false;
+    is_reached[0] = true;
+    pending[pending_count++] = 0;
+    while (pending_count > 0 && !has_start) {
+        int pc = pending[--pending_count];
+        Instruction *instruction = &code->instructions[pc];
+        int next[2] = { pc + 1, -1 };
+        switch (instruction->opcode) {
+        default: {
+        } break;
+        case OP_START: {
+            has_start = true;
+        } break;
+        case OP_HALT:
+        case OP_RET: {
+            next[0] = -1;
+        } break;
+        case OP_JUMP: {
+            next[0] = instruction->as.target;
+        } break;
+        case OP_CALL:
+        case OP_END_LOOP: {
+            next[1] = instruction->as.target;
+        } break;
+        case OP_ROUNDS: {
+            next[1] = instruction->as.rounds.end;
+        } break;
+        }
+        for (int j = 0; j < 2; j++) {
+            if (next[j] >= 0 && !is_reached[next[j]]) {
+                is_reached[next[j]] = true;
+                pending[pending_count++] = next[j];
+            }
+        }
+    }
+
+    arena_rewind(arena, mark);
+    return has_start;
+}
+
+static void bytecode_lower(Compiler *c) {
+    Bytecode *code = &c->bytecode;
+    Token *tokens = c->tokens;
+    Arena *arena = &c->arena;
+    *code = (Bytecode){0};
+
+    // as deep as the parens nest, grown in the arena along with the bytecode
+    Bytecode_Open_Block *open_blocks = NULL;
+    int open_block_capacity = 0;
+    int open_block_count = 0;
+
+    // starting from a position works like a start marker in front of the first token there,
+    // the start markers in the program are ignored then
+    bool is_from_position = c->start_line_number >= 0;
+    bool has_start_position = is_from_position;
+
+    for (int i = 0; i < c->token_amount; i++) {
+        // room for the block the token might open
+        arena_reserve(arena, (void **)&open_blocks, &open_block_capacity, open_block_count + 1, sizeof(Bytecode_Open_Block));
+        if (
+            has_start_position && (
+                tokens[i].line_number > c->start_line_number ||
+                (tokens[i].line_number == c->start_line_number && tokens[i].char_index >= c->start_char_idx)
+            )
+        ) {
+            bytecode_add(arena, code, OP_START);
+            has_start_position = false;
+        }
+        switch (tokens[i].type) {
+        default:
+            ASSERT(false);
+            break;
+        case TOKEN_PLAY:
+        case TOKEN_WAIT: {
+            Instruction *instruction = bytecode_add(arena, code, OP_EMIT_TONE);
+            instruction->as.tone.is_play = tokens[i].type == TOKEN_PLAY;
+            instruction->as.tone.duration = tokens[i].value.play_or_wait.duration;
+            instruction->as.tone.line_idx = tokens[i].line_number;
+            instruction->as.tone.char_idx = tokens[i].char_index;
+            instruction->as.tone.char_count = tokens[i].value.play_or_wait.char_count;
+        } break;
+        case TOKEN_START: {
+            if (!is_from_position) {
+                bytecode_add(arena, code, OP_START);
+            }
+        } break;
+        case TOKEN_SINE:        { bytecode_add(arena, code, OP_SET_WAVEFORM)->as.number = WAVEFORM_SINE; } break;
+        case TOKEN_TRIANGLE:    { bytecode_add(arena, code, OP_SET_WAVEFORM)->as.number = WAVEFORM_TRIANGLE; } break;
+        case TOKEN_SQUARE:      { bytecode_add(arena, code, OP_SET_WAVEFORM)->as.number = WAVEFORM_SQUARE; } break;
+        case TOKEN_SAWTOOTH:    { bytecode_add(arena, code, OP_SET_WAVEFORM)->as.number = WAVEFORM_SAWTOOTH; } break;
+        case TOKEN_BPM: {
+            i += 1;
+            bytecode_add(arena, code, OP_SET_BPM)->as.number = tokens[i].value.int_number;
+        } break;
+        case TOKEN_NOTE: {
+            bytecode_add(arena, code, OP_SET_NOTE)->as.number = tokens[i].value.int_number;
+        } break;
+        case TOKEN_SEMI:
+        case TOKEN_RISE:
+        case TOKEN_FALL: {
+            // the validator only lets "semi" stand right before "rise" or "fall"
+            bool is_chromatic = tokens[i].type == TOKEN_SEMI;
+            if (is_chromatic) {
+                i++;
+            }
+            Instruction *instruction = bytecode_add(arena, code, OP_TRANSPOSE);
+            instruction->as.transpose.direction = tokens[i].type == TOKEN_RISE ? 1 : -1;
+            instruction->as.transpose.is_chromatic = is_chromatic;
+            instruction->as.transpose.steps = 1;
+            if (i + 1 < c->token_amount && tokens[i + 1].type == TOKEN_NUMBER) {
+                i++;
+                instruction->as.transpose.steps = tokens[i].value.int_number;
+            }
+        } break;
+        case TOKEN_CHORD: {
+            i += 2;
+            Chord chord = get_chord(c->token_amount, tokens, &i, NULL);
+            bytecode_add(arena, code, OP_SET_CHORD)->as.number = bytecode_add_chord(arena, code, chord);
+        } break;
+        case TOKEN_SCALE: {
+            i += 2;
+            bytecode_add(arena, code, OP_SET_SCALE)->as.number = get_scale(c->token_amount, tokens, &i, NULL);
+        } break;
+        case TOKEN_REPEAT: {
+            i++;
+            bytecode_add(arena, code, OP_LOOP)->as.number = tokens[i].value.int_number;
+            i++;
+            open_blocks[open_block_count++] = (Bytecode_Open_Block){ BLOCK_REPEAT, code->instruction_count };
+        } break;
+        case TOKEN_FOREVER: {
+            i++;
+            open_blocks[open_block_count++] = (Bytecode_Open_Block){ BLOCK_FOREVER, code->instruction_count };
+        } break;
+        case TOKEN_ROUNDS: {
+            int amount = tokens[i].value.int_number;
+            Instruction *instruction = bytecode_add(arena, code, OP_ROUNDS);
+            instruction->as.rounds.first = code->round_number_count;
+            instruction->as.rounds.count = amount;
+            for (int j = 0; j < amount; j++) {
+                bytecode_add_round_number(arena, code, tokens[i + j + 1].value.int_number);
+            }
+            i += amount + 1;
+            open_blocks[open_block_count++] = (Bytecode_Open_Block){ BLOCK_ROUNDS, code->instruction_count - 1 };
+        } break;
+        case TOKEN_DEFINE: {
+            Symbol *symbol = symbol_table_get(&c->symbols, tokens[i + 1].value.identifier.symbol_id);
+            i += 2;
+            // a define is only entered through a call, straight line code jumps over it
+            bytecode_add(arena, code, OP_JUMP);
+            symbol->code_address = code->instruction_count;
+            open_blocks[open_block_count++] = (Bytecode_Open_Block){ BLOCK_DEFINE, code->instruction_count - 1 };
+        } break;
+        case TOKEN_IDENTIFIER: {
+            Symbol *symbol = symbol_table_get(&c->symbols, tokens[i].value.identifier.symbol_id);
+            // a call right before the end of a define can reuse that define's return
+            bool is_tail_call =
+                i + 1 < c->token_amount &&
+                tokens[i + 1].type == TOKEN_PAREN_CLOSE &&
+                open_block_count > 0 &&
+                open_blocks[open_block_count - 1].block == BLOCK_DEFINE;
+            bytecode_add(arena, code, is_tail_call ? OP_JUMP : OP_CALL)->as.target = symbol->code_address;
+        } break;
+        case TOKEN_PAREN_CLOSE: {
+            ASSERT(open_block_count > 0);
+            Bytecode_Open_Block open = open_blocks[--open_block_count];
+            switch (open.block) {
+            case BLOCK_REPEAT: {
+                bytecode_add(arena, code, OP_END_LOOP)->as.target = open.address;
+            } break;
+            case BLOCK_FOREVER: {
+                bytecode_add(arena, code, OP_JUMP)->as.target = open.address;
+            } break;
+            case BLOCK_ROUNDS: {
+                code->instructions[open.address].as.rounds.end = code->instruction_count;
+            } break;
+            case BLOCK_DEFINE: {
+                bytecode_add(arena, code, OP_RET);
+                code->instructions[open.address].as.target = code->instruction_count;
+            } break;
+            }
+        } break;
+        }
+    }
+
+    // a position after the last token leaves nothing to play
+    if (has_start_position) {
+        bytecode_add(arena, code, OP_START);
+    }
+    bytecode_add(arena, code, OP_HALT);
+    code->has_start = bytecode_reaches_start(arena, code);
+}
+
+#endif
@@ -8,64 +8,155 @@
 #include "../windows_wrapper.h"
 
 #include "error.c"
+#include "symbol_table.c"
+#include "keywords.c"
+#include "lex_cache.c"
 #include "lexer.c"
 #include "validator.c"
+#include "bytecode.c"
 #include "parser.c"
+#include "analyzer.c"
 
 void compiler_init(Compiler *c) {
+    note_tables_init();
+    arena_init(&c->arena, DYN_MEM_TAG_COMPILE, COMPILER_ARENA_CHUNK_SIZE);
     c->mutex = mutex_create();
 }
 
+// lexes and validates the program, false with the error set when it is not valid
+static bool compiler_validate(Compiler *c, DynArray *data) {
+    c->data = data;
+    if (c->data == NULL) {
+        thread_error();
+    }
+
+    // checkpoints belong to the program that was compiled last
+    parser_checkpoints_free(&c->checkpoints);
+    arena_reset(&c->arena);
+    c->bytecode = (Bytecode){0};
+    c->symbols = (Symbol_Table){0};
+
+    c->tokens = NULL;
+    c->line_number = -1;
+    c->char_idx = 0;
+    c->error_type = NO_ERROR;
+
+    Compiler_Error lexer_error = lexer_run(c);
+    if (lexer_error != NO_ERROR) {
+        c->error_type = lexer_error;
+        populate_error_message(c, c->line_number, c->char_idx);
+        return false;
+    }
+
+    Compiler_Error_Address validator_error = validator_run(c);
+    if (validator_error.type != NO_ERROR) {
+        c->error_type = validator_error.type;
+        c->line_number = c->tokens[validator_error.token_idx].line_number;
+        c->char_idx = c->tokens[validator_error.token_idx].char_index;
+        populate_error_message(c, c->line_number, c->char_idx);
+        return false;
+    }
+    return true;
+}
+
+// lexes, validates and lowers the program, false with the error set when it does not compile
+static bool compiler_build(Compiler *c, DynArray *data) {
+    if (!compiler_validate(c, data)) {
+        return false;
+    }
+    bytecode_lower(c);
+    return true;
+}
+
+// plays from the first token at or after the position, a line number of -1 plays from the beginning
+void compiler_start_from(Compiler *c, DynArray *data, int line_number, int char_idx) {
+    mutex_lock(c->mutex);
+        c->start_line_number = line_number;
+        c->start_char_idx = char_idx;
+        if (!compiler_build(c, data)) {
+            mutex_unlock(c->mutex);
+            return;
+        }
+
+        c->flags |= COMPILER_FLAG_IN_PROCESS;
+        parser_init(&c->parser, c->bytecode.has_start);
+        parser_run(c);
+        handle_no_sound_error(c);
+
+    mutex_unlock(c->mutex);
+}
+
 void compiler_start(Compiler *c, DynArray *data) {
+    compiler_start_from(c, data, -1, 0);
+}
+
+// compiles the program without playing it and works out what it would play, false when it does not compile
+bool compiler_analyze(Compiler *c, DynArray *data, Analysis *analysis) {
     mutex_lock(c->mutex);
-        c->data = data;
-        if (c->data == NULL) {
-            thread_error();
+        c->start_line_number = -1;
+        c->start_char_idx = 0;
+        bool is_compiled = compiler_build(c, data);
+        if (is_compiled) {
+            *analysis = analyzer_run(c);
         }
+    mutex_unlock(c->mutex);
+    return is_compiled;
+}
 
-        c->tokens = NULL;
-        c->line_number = -1;
-        c->char_idx = 0;
-        c->error_type = NO_ERROR;
+// only looks for errors, line_number and char_idx tell where the error is when it returns false
+bool compiler_check(Compiler *c, DynArray *data) {
+    mutex_lock(c->mutex);
+        c->start_line_number = -1;
+        c->start_char_idx = 0;
+        bool is_valid = compiler_validate(c, data);
+    mutex_unlock(c->mutex);
+    return is_valid;
+}
 
-        Compiler_Error lexer_error = lexer_run(c);
-        if (lexer_error != NO_ERROR) {
-            c->error_type = lexer_error;
-            populate_error_message(c, c->line_number, c->char_idx);
+// plays from the first tone starting at or after this many seconds into the compiled program,
+// start markers are ignored. The checkpoints recorded on the way make seeking back and forth cheap,
+// only the music since the nearest one before the time is replayed
+void compiler_seek(Compiler *c, double seconds) {
+    mutex_lock(c->mutex);
+        if (c->bytecode.instruction_count == 0) {
+            mutex_unlock(c->mutex);
             return;
         }
+        c->error_type = NO_ERROR;
 
-        Compiler_Error_Address validator_error = validator_run(c);
-        if (validator_error.type != NO_ERROR) {
-            c->error_type = validator_error.type;
-            populate_error_message(
-                c,
-                c->tokens[validator_error.token_idx].line_number,
-                c->tokens[validator_error.token_idx].char_index
-            );
-            return;
+        Parser_Checkpoints *checkpoints = &c->checkpoints;
+        if (!checkpoints->is_recording) {
+            parser_init(&checkpoints->recorder, false);
+            checkpoints->is_recording = true;
+        }
+        if (!checkpoints->is_complete) {
+            parser_execute(c, &checkpoints->recorder, checkpoints, seconds);
         }
 
+        int checkpoint_idx = parser_checkpoint_find(checkpoints, seconds);
+        if (checkpoint_idx >= 0) {
+            parser_checkpoint_restore(&c->parser, checkpoints, checkpoint_idx);
+        } else {
+            parser_init(&c->parser, false);
+        }
+        c->parser.is_seeking = true;
+        c->parser.seek_until_seconds = seconds;
+
         c->flags |= COMPILER_FLAG_IN_PROCESS;
-        parser_init(&c->parser);
         parser_run(c);
         handle_no_sound_error(c);
-
     mutex_unlock(c->mutex);
 }
 
-bool compiler_can_continue(Compiler *c) {
-    bool x = true;
+// compiles the program and plays it from this many seconds in, without parsing the start of it first
+void compiler_start_at_seconds(Compiler *c, DynArray *data, double seconds) {
     mutex_lock(c->mutex);
-        if (has_flag(c->flags, COMPILER_FLAG_OUTPUT_AVAILABLE)) {
-            if (has_flag(c->flags, COMPILER_FLAG_OUTPUT_HANDLED)) {
-                c->flags &= ~(COMPILER_FLAG_OUTPUT_AVAILABLE | COMPILER_FLAG_OUTPUT_HANDLED);
-            } else {
-                x = false;
-            }
+        c->start_line_number = -1;
+        c->start_char_idx = 0;
+        if (compiler_build(c, data)) {
+            compiler_seek(c, seconds);
         }
     mutex_unlock(c->mutex);
-    return x;
 }
 
 void compiler_continue(Compiler *c) {
@@ -75,34 +166,47 @@ void compiler_continue(Compiler *c) {
     mutex_unlock(c->mutex);
 }
 
-void compiler_output_handled(Compiler *c) {
+bool compiler_is_cancelled(Compiler *c) {
+    mutex_lock(c->mutex);
+        bool is_cancelled = has_flag(c->flags, COMPILER_FLAG_CANCELLED);
+    mutex_unlock(c->mutex);
+    return is_cancelled;
+}
+
+// checked by the compiler thread between batches, synthesizer_cancel wakes it while it waits for room
+void compiler_cancel(Compiler *c) {
     mutex_lock(c->mutex);
-        c->flags |= COMPILER_FLAG_OUTPUT_HANDLED;
+        c->flags |= COMPILER_FLAG_CANCELLED;
     mutex_unlock(c->mutex);
 }
 
 void compiler_reset(Compiler *c) {
     mutex_lock(c->mutex);
         c->flags |= COMPILER_FLAG_CANCELLED;
-        for (int i = 0; i < c->token_amount; i += 1) {
-            switch (c->tokens[i].type) {
-            case TOKEN_IDENTIFIER:
-                dyn_mem_release(c->tokens[i].value.string);
-                c->tokens[i].value.string = NULL;
-                break;
-            default:
-                break;
-            }
-        }
-        if (c->tokens != NULL) {
-            dyn_mem_release(c->tokens);
-            c->tokens = NULL;
-        }
+        parser_checkpoints_free(&c->checkpoints);
+        // tokens, symbols and bytecode all at once
+        arena_reset(&c->arena);
+        Arena arena = c->arena;
+        // like the arena's chunks the parser's stacks are kept for the next program
+        Parser parser = c->parser;
+        Mutex mutex = c->mutex;
+        Lex_Cache *lex_cache = c->lex_cache;
         *c = (Compiler){0};
+        c->mutex = mutex;
+        c->lex_cache = lex_cache;
+        c->arena = arena;
+        c->parser.loops = parser.loops;
+        c->parser.loop_capacity = parser.loop_capacity;
+        c->parser.returns = parser.returns;
+        c->parser.return_capacity = parser.return_capacity;
+        c->parser.seek_snapshot = parser.seek_snapshot;
+        c->parser.seek_snapshot_capacity = parser.seek_snapshot_capacity;
     mutex_unlock(c->mutex);
 }
 
 void compiler_free(Compiler *c) {
     compiler_reset(c);
+    parser_free(&c->parser);
+    arena_free(&c->arena);
     mutex_destroy(c->mutex);
 }
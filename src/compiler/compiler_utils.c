@@ -12,6 +12,80 @@ static int get_note_flag(int note) {
     return 1 << (note + MAX_NOTE_FROM_C0) % OCTAVE;
 }
 
+// indexed by the note's byte so every int8 note has an entry
+static float note_frequencies[256];
+static Scale_Steps scale_steps[SCALE_MASK_COUNT];
+
+inline static float note_to_frequency(int semi_offset) {
+    return A4_FREQ * powf(2.0f, (float)semi_offset / (float)OCTAVE);
+}
+
+inline static float note_frequency(int8 note) {
+    return note_frequencies[(uint8)note];
+}
+
+// how many frames the synthesizer renders for a tone of this length
+inline static int duration_frame_count(float duration, int sample_rate) {
+    return (int)(duration * (float)sample_rate);
+}
+
+inline static int note_pitch_class(int note) {
+    return (note % OCTAVE + OCTAVE) % OCTAVE;
+}
+
+// fills the tables once, the compiler only does lookups after this
+static void note_tables_init() {
+    static bool is_initialized = false;
+    if (is_initialized) {
+        return;
+    }
+    for (int i = 0; i < 256; i++) {
+        note_frequencies[i] = note_to_frequency((int8)i);
+    }
+    for (int scale = 1; scale < SCALE_MASK_COUNT; scale++) {
+        Scale_Steps *steps = &scale_steps[scale];
+        steps->degree_count = 0;
+        for (int pitch_class = 0; pitch_class < OCTAVE; pitch_class++) {
+            steps->degree_count += has_flag(scale, 1 << pitch_class);
+            int up = 1;
+            while (!has_flag(scale, 1 << ((pitch_class + up) % OCTAVE))) {
+                up++;
+            }
+            int down = 1;
+            while (!has_flag(scale, 1 << ((pitch_class - down + OCTAVE) % OCTAVE))) {
+                down++;
+            }
+            steps->up[pitch_class] = up;
+            steps->down[pitch_class] = down;
+        }
+    }
+    is_initialized = true;
+}
+
+// moves a note by a number of scale degrees, the first step lands on the nearest degree in that direction.
+// from a degree every degree_count steps is exactly an octave, so only the remainder is stepped
+inline static int note_transpose(int note, int scale, int direction, int steps) {
+    Scale_Steps *scale_step = &scale_steps[scale & (SCALE_MASK_COUNT - 1)];
+    int8 *step = direction > 0 ? scale_step->up : scale_step->down;
+    int pitch_class = note_pitch_class(note);
+    if (steps > scale_step->degree_count) {
+        int octaves = (steps - 1) / scale_step->degree_count;
+        note += direction * OCTAVE * octaves;
+        steps -= octaves * scale_step->degree_count;
+    }
+    for (; steps > 0; steps--) {
+        int distance = direction * step[pitch_class];
+        note += distance;
+        pitch_class += distance;
+        if (pitch_class >= OCTAVE) {
+            pitch_class -= OCTAVE;
+        } else if (pitch_class < 0) {
+            pitch_class += OCTAVE;
+        }
+    }
+    return note;
+}
+
 static bool peek_token(Compiler *result, int index, int offset, Token **token_ptr) {
     int actual = index + offset;
     if (actual == 0 || actual >= result->token_amount) {
@@ -1,69 +1,52 @@
 #include "../main.h"
 
-static void populate_error_message(Compiler *compiler, int line_number, int char_idx) {
-    compiler->error_message[0] = '\0';
-    char str_buffer[128];
-
-    switch (compiler->error_type) {
+// what went wrong, without saying where
+static const char *error_description(Compiler_Error error) {
+    switch (error) {
     case NO_ERROR:
-        sprintf(str_buffer, "No error");
-        break;
+        return "No error";
     case ERROR_SYNTAX_ERROR:
-        sprintf(str_buffer, "This is wrong");
-        break;
+        return "This is wrong";
     case ERROR_INVALID_SEMI:
-        sprintf(str_buffer, "\"SEMI\" must be followed\nby one of these:\nRISE, FALL");
-        break;
+        return "\"SEMI\" must be followed\nby one of these:\nRISE, FALL";
     case ERROR_UNKNOWN_IDENTIFIER:
-        sprintf(str_buffer, "This thing is not at all known");
-        break;
+        return "This thing is not at all known";
     case ERROR_EXPECTED_IDENTIFIER:
-        sprintf(str_buffer, "Expected an identifier after this");
-        break;
+        return "Expected an identifier after this";
     case ERROR_EXPECTED_PAREN_OPEN:
-        sprintf(str_buffer, "Expected a \'(\' after this");
-        break;
+        return "Expected a \'(\' after this";
     case ERROR_NO_SCALE_IDENTIFIER:
-        sprintf(str_buffer, "You should come up with a\nname for the scale here");
-        break;
+        return "You should come up with a\nname for the scale here";
     case ERROR_EXPECTED_NUMBER:
-        sprintf(str_buffer, "There should be a number after this");
-        break;
+        return "There should be a number after this";
     case ERROR_NUMBER_TOO_BIG:
-        sprintf(str_buffer, "This number is way too large");
-        break;
+        return "This number is way too large";
     case ERROR_NO_MATCHING_OPENING_PAREN:
-        sprintf(str_buffer, "This has no matching \'(\'");
-        break;
+        return "This has no matching \'(\'";
     case ERROR_NO_MATCHING_CLOSING_PAREN:
-        sprintf(str_buffer, "This has no matching \')\'");
-        break;
+        return "This has no matching \')\'";
     case ERROR_MULTIPLE_DEFINITIONS:
-        sprintf(str_buffer, "This has already been defined");
-        break;
-    case ERROR_NESTING_TOO_DEEP:
-        sprintf(str_buffer, "Nesting this many \"()\" is too much");
-        break;
+        return "This has already been defined";
     case ERROR_CHORD_CAN_ONLY_CONTAIN_NOTES:
-        sprintf(str_buffer, "Chords may only contain\nnotes, not this thing");
-        break;
+        return "Chords may only contain\nnotes, not this thing";
     case ERROR_CHORD_CAN_NOT_BE_EMPTY:
-        sprintf(str_buffer, "Chords can not be completely\nempty like that");
-        break;
+        return "Chords can not be completely\nempty like that";
     case ERROR_CHORD_TOO_MANY_NOTES:
-        sprintf(str_buffer, "Chords can not have this many\nnotes for some reason");
-        break;
+        return "Chords can not have this many\nnotes for some reason";
     case ERROR_SCALE_CAN_ONLY_CONTAIN_NOTES:
-        sprintf(str_buffer, "Scales may only contain\nnotes, not this thing");
-        break;
+        return "Scales may only contain\nnotes, not this thing";
     case ERROR_SCALE_CAN_NOT_BE_EMPTY:
-        sprintf(str_buffer, "Scales can not be completely\nempty like that");
-        break;
+        return "Scales can not be completely\nempty like that";
     default:
-        sprintf(str_buffer, "Unknown error");
-        break;
+        return "Unknown error";
     }
-    strcat(compiler->error_message, str_buffer);
+}
+
+static void populate_error_message(Compiler *compiler, int line_number, int char_idx) {
+    compiler->error_message[0] = '\0';
+    char str_buffer[128];
+
+    strcat(compiler->error_message, error_description(compiler->error_type));
 
     int visual_line_number = line_number + 1;
     sprintf(str_buffer, "\nOn line %d:\n", visual_line_number);
@@ -74,7 +57,7 @@ static void populate_error_message(Compiler *compiler, int line_number, int char
     int slice_padding = 10;
     int slice_end = (slice_start > 0 ? char_idx : slice_max_right) + slice_padding;
     int slice_len = slice_end - slice_start + 1;
-    char slice[slice_len];
+    char slice[slice_len + 1];
     {
         int i;
         for (i = 0; i < slice_len; i++) {
@@ -0,0 +1,71 @@
+#ifndef KEYWORDS_C
+#define KEYWORDS_C
+
+#include "../main.h"
+
+#define KEYWORD_IS(literal) (memcmp(word, literal, sizeof(literal) - 1) == 0)
+
+// the one list of keywords, shared by the lexer and the syntax highlighter.
+// word points straight into the line and is not terminated, length is the whole word,
+// so switching on the length and the first character leaves at most one memcmp
+static Token_Type keyword_token_type(const char *word, int length) {
+    switch (length) {
+    case 3: {
+        if (KEYWORD_IS("bpm")) return TOKEN_BPM;
+    } break;
+    case 4: {
+        switch (word[0]) {
+        case 'f': if (KEYWORD_IS("fall")) return TOKEN_FALL; break;
+        case 'p': if (KEYWORD_IS("play")) return TOKEN_PLAY; break;
+        case 'r': if (KEYWORD_IS("rise")) return TOKEN_RISE; break;
+        case 's': {
+            if (KEYWORD_IS("sine")) return TOKEN_SINE;
+            if (KEYWORD_IS("semi")) return TOKEN_SEMI;
+        } break;
+        case 'w': if (KEYWORD_IS("wait")) return TOKEN_WAIT; break;
+        }
+    } break;
+    case 5: {
+        switch (word[0]) {
+        case 'c': if (KEYWORD_IS("chord")) return TOKEN_CHORD; break;
+        case 's': {
+            if (KEYWORD_IS("start")) return TOKEN_START;
+            if (KEYWORD_IS("scale")) return TOKEN_SCALE;
+        } break;
+        }
+    } break;
+    case 6: {
+        switch (word[0]) {
+        case 'd': if (KEYWORD_IS("define")) return TOKEN_DEFINE; break;
+        case 'r': {
+            if (KEYWORD_IS("repeat")) return TOKEN_REPEAT;
+            if (KEYWORD_IS("rounds")) return TOKEN_ROUNDS;
+        } break;
+        case 's': if (KEYWORD_IS("square")) return TOKEN_SQUARE; break;
+        }
+    } break;
+    case 7: {
+        if (KEYWORD_IS("forever")) return TOKEN_FOREVER;
+    } break;
+    case 8: {
+        switch (word[0]) {
+        case 's': if (KEYWORD_IS("sawtooth")) return TOKEN_SAWTOOTH; break;
+        case 't': if (KEYWORD_IS("triangle")) return TOKEN_TRIANGLE; break;
+        }
+    } break;
+    }
+    return TOKEN_NONE;
+}
+
+#undef KEYWORD_IS
+
+// length of the identifier starting at char_idx, 0 when there is none
+inline static int line_word_length(DynArray *line, int char_idx) {
+    int length = 0;
+    while (is_valid_in_identifier(dyn_char_get(line, char_idx + length))) {
+        length++;
+    }
+    return length;
+}
+
+#endif
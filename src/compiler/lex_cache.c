@@ -0,0 +1,117 @@
+#ifndef LEX_CACHE_C
+#define LEX_CACHE_C
+
+#include <string.h>
+
+#include "../main.h"
+
+// the editor reports every line it changes, inserts or removes, so a compile only lexes
+// the lines that changed since the last one. Until the first compile and after anything
+// the cache cannot follow it is empty, which makes the next compile lex every line.
+// Only lexing is saved: the cached tokens are still copied, linked, interned and validated
+// as a whole on every compile, since all of that lives in the compile arena
+void lex_cache_clear(Lex_Cache *cache) {
+    for (int i = 0; i < cache->line_count; i++) {
+        if (cache->lines[i].tokens != NULL) {
+            dyn_mem_release(cache->lines[i].tokens);
+        }
+    }
+    cache->line_count = 0;
+    cache->revision++;
+}
+
+void lex_cache_free(Lex_Cache *cache) {
+    lex_cache_clear(cache);
+    if (cache->lines != NULL) {
+        dyn_mem_release(cache->lines);
+    }
+    *cache = (Lex_Cache){0};
+}
+
+static void lex_cache_reserve(Lex_Cache *cache, int line_count) {
+    if (line_count <= cache->line_capacity) {
+        return;
+    }
+    while (cache->line_capacity < line_count) {
+        cache->line_capacity = cache->line_capacity == 0 ? 64 : cache->line_capacity * 2;
+    }
+    cache->lines = (Lex_Line *)dyn_mem_realloc(cache->lines, sizeof(Lex_Line) * cache->line_capacity);
+    if (cache->lines == NULL) {
+        thread_error();
+    }
+}
+
+void lex_cache_line_changed(Lex_Cache *cache, int line_idx) {
+    if (line_idx < 0 || line_idx >= cache->line_count) {
+        lex_cache_clear(cache);
+        return;
+    }
+    cache->lines[line_idx].is_dirty = true;
+    cache->revision++;
+}
+
+void lex_cache_lines_inserted(Lex_Cache *cache, int line_idx, int count) {
+    if (line_idx < 0 || line_idx > cache->line_count) {
+        lex_cache_clear(cache);
+        return;
+    }
+    lex_cache_reserve(cache, cache->line_count + count);
+    memmove(&cache->lines[line_idx + count], &cache->lines[line_idx], sizeof(Lex_Line) * (cache->line_count - line_idx));
+    for (int i = line_idx; i < line_idx + count; i++) {
+        cache->lines[i] = (Lex_Line){ .is_dirty = true };
+    }
+    cache->line_count += count;
+    cache->revision++;
+}
+
+void lex_cache_lines_removed(Lex_Cache *cache, int line_idx, int count) {
+    if (line_idx < 0 || line_idx + count > cache->line_count) {
+        lex_cache_clear(cache);
+        return;
+    }
+    for (int i = line_idx; i < line_idx + count; i++) {
+        if (cache->lines[i].tokens != NULL) {
+            dyn_mem_release(cache->lines[i].tokens);
+        }
+    }
+    memmove(&cache->lines[line_idx], &cache->lines[line_idx + count], sizeof(Lex_Line) * (cache->line_count - line_idx - count));
+    cache->line_count -= count;
+    cache->revision++;
+}
+
+// a cache that lost track of the lines starts over with all of them dirty
+static void lex_cache_fit(Lex_Cache *cache, int line_count) {
+    if (cache->line_count == line_count) {
+        return;
+    }
+    lex_cache_clear(cache);
+    lex_cache_lines_inserted(cache, 0, line_count);
+}
+
+// how many tokens the lines had when they were last lexed, which edits seldom change by much
+static int lex_cache_token_count(Lex_Cache *cache) {
+    int token_count = 0;
+    for (int i = 0; i < cache->line_count; i++) {
+        token_count += cache->lines[i].token_count;
+    }
+    return token_count;
+}
+
+static void lex_line_store(Lex_Line *line, Token *tokens, int token_count, Compiler_Error error, int error_char_idx) {
+    if (token_count > line->token_capacity) {
+        line->token_capacity = token_count;
+        line->tokens = (Token *)dyn_mem_realloc(line->tokens, sizeof(Token) * line->token_capacity);
+        if (line->tokens == NULL) {
+            thread_error();
+        }
+    }
+    if (token_count > 0) {
+        memcpy(line->tokens, tokens, sizeof(Token) * token_count);
+    }
+    line->token_count = token_count;
+    line->error = error;
+    line->error_char_idx = error_char_idx;
+    line->is_dirty = false;
+}
+
+#endif
@@ -3,8 +3,6 @@
 #include "../windows_wrapper.h"
 #include "../main.h"
 
-#define MAX_PAREN_NESTING 32
-
 inline static int char_to_int(char c) {
     return c - 48;
 }
@@ -43,7 +41,29 @@ inline static int str_to_int(DynArray *string, int idx, Compiler_Error *error) {
     return number;
 }
 
+// tokens stay one contiguous array so the validator and parser can walk it by index,
+// it doubles when full so lexing stays linear however long the program is
+inline static void token_reserve(Compiler *compiler, int count) {
+    int needed = compiler->token_amount + count;
+    if (needed <= compiler->token_capacity) {
+        return;
+    }
+    while (compiler->token_capacity < needed) {
+        compiler->token_capacity *= 2;
+    }
+    compiler->tokens = (Token *)arena_grow(
+        &compiler->arena,
+        compiler->tokens,
+        sizeof(Token) * compiler->token_amount,
+        sizeof(Token) * compiler->token_capacity
+    );
+    if (compiler->tokens == NULL) {
+        thread_error();
+    }
+}
+
 inline static Token *token_add(Compiler *compiler, Token_Type token_type) {
+    token_reserve(compiler, 1);
     int address = compiler->token_amount;
     Token* token = &(compiler->tokens[address]);
     token->address = address;
@@ -239,119 +259,158 @@ static bool try_get_note_token(Compiler *compiler) {
     return true;
 }
 
+// the parens still open, grown in the compile arena so there is no limit to nesting them
+typedef struct Lexer_Parens {
+    int nest_level;
+    int *open_addresses;
+    int open_capacity;
+} Lexer_Parens;
+
+// lexes the line at c->line_number onto the end of the tokens and stops at the first error,
+// leaving c->char_idx on it. Nothing here depends on other lines, so the result can be cached
+static Compiler_Error lexer_line(Compiler *c) {
+    DynArray *line = dyn_array_get(c->data, c->line_number);
+    c->char_idx = 0;
+    for (int *i = &(c->char_idx); dyn_char_get(line, *i) != '\0' && dyn_char_get(line, *i) != COMMENT_CHAR; *i += 1) {
+        if (isspace(dyn_char_get(line, *i))) {
+            continue;
+        }
+        switch (dyn_char_get(line, *i)) {
+        case '(': {
+            token_add(c, TOKEN_PAREN_OPEN);
+        } break;
+        case ')': {
+            token_add(c, TOKEN_PAREN_CLOSE);
+        } break;
+        default: {
+            if (try_get_note_token(c)) {
+                break;
+            }
+            if (try_get_play_or_wait_token(c)) {
+                break;
+            }
+            if (is_numeric(dyn_char_get(line, *i))) {
+                Compiler_Error str_to_int_error = NO_ERROR;
+                int number = str_to_int(line, *i, &str_to_int_error);
+                if (str_to_int_error != NO_ERROR) {
+                    return str_to_int_error;;
+                }
+                Token *token = token_add(c, TOKEN_NUMBER);
+                token->value.int_number = number;
+                *i += (digit_count(number) - 1);
+                break;
+            }
+            if (!is_valid_in_identifier(dyn_char_get(line, *i))) {
+                return ERROR_SYNTAX_ERROR;
+            }
+            int ident_length = line_word_length(line, *i);
+            const char *ident = (const char *)line->data + *i;
+            Token_Type keyword = keyword_token_type(ident, ident_length);
+            if (keyword != TOKEN_NONE) {
+                token_add(c, keyword);
+            } else {
+                Token *token = token_add(c, TOKEN_IDENTIFIER);
+                token->value.name.hash = symbol_table_hash(ident, ident_length);
+                token->value.name.length = ident_length;
+            }
+            *i += (ident_length - 1);
+        } break;
+        }
+    }
+    return NO_ERROR;
+}
+
+// the part of lexing that spans lines: gives the line's tokens their place in the program,
+// matches their parens and interns their identifiers
+static Compiler_Error lexer_link_line(Compiler *c, int first_token, Lexer_Parens *parens) {
+    DynArray *line = dyn_array_get(c->data, c->line_number);
+    for (int address = first_token; address < c->token_amount; address++) {
+        Token *token = &c->tokens[address];
+        token->address = address;
+        token->line_number = c->line_number;
+        switch (token->type) {
+        default:
+            break;
+        case TOKEN_PAREN_OPEN: {
+            arena_reserve(&c->arena, (void **)&parens->open_addresses, &parens->open_capacity, parens->nest_level + 1, sizeof(int));
+            token->value.int_number = -1;
+            parens->open_addresses[parens->nest_level] = address;
+            parens->nest_level += 1;
+        } break;
+        case TOKEN_PAREN_CLOSE: {
+            parens->nest_level -= 1;
+            if (parens->nest_level < 0) {
+                c->char_idx = token->char_index;
+                c->token_amount = address;
+                return ERROR_NO_MATCHING_OPENING_PAREN;
+            }
+            int paren_open_address = parens->open_addresses[parens->nest_level];
+            token->value.int_number = paren_open_address;
+            c->tokens[paren_open_address].value.int_number = address;
+        } break;
+        case TOKEN_IDENTIFIER: {
+            const char *name = (const char *)line->data + token->char_index;
+            uint32 hash = token->value.name.hash;
+            int length = token->value.name.length;
+            token->value.identifier.symbol_id = symbol_table_intern_hashed(&c->symbols, name, length, hash);
+            token->value.identifier.define_address = -1;
+        } break;
+        }
+    }
+    return NO_ERROR;
+}
+
 static Compiler_Error lexer_run(Compiler *c) {
+    Lex_Cache *cache = c->lex_cache;
     c->token_amount = 0;
-    c->tokens = (Token *)dyn_mem_alloc(sizeof(Token) * 4096);
+    c->token_capacity = TOKEN_INITIAL_CAPACITY;
+    if (cache != NULL) {
+        lex_cache_fit(cache, c->data->length);
+        // growing the tokens in the arena copies them, so they start out as many as last time
+        int cached_token_count = lex_cache_token_count(cache);
+        while (c->token_capacity < cached_token_count) {
+            c->token_capacity *= 2;
+        }
+    }
+    c->tokens = (Token *)arena_alloc(&c->arena, sizeof(Token) * c->token_capacity);
     if (c->tokens == NULL) {
         thread_error();
     }
+    symbol_table_init(&c->symbols, &c->arena);
 
-    int paren_nest_level = 0;
-    int paren_open_addresses[MAX_PAREN_NESTING] = {0};
+    Lexer_Parens parens = {0};
     for (int line_i = 0; line_i < c->data->length; line_i++) {
-        DynArray *line = dyn_array_get(c->data, line_i);
-        c->line_number++;
-        c->char_idx = 0;
-        for (int *i = &(c->char_idx); dyn_char_get(line, *i) != '\0' && dyn_char_get(line, *i) != COMMENT_CHAR; *i += 1) {
-            if (isspace(dyn_char_get(line, *i))) {
-                continue;
+        c->line_number = line_i;
+        int first_token = c->token_amount;
+        Compiler_Error line_error;
+        int error_char_idx;
+
+        Lex_Line *cached = cache != NULL ? &cache->lines[line_i] : NULL;
+        if (cached != NULL && !cached->is_dirty) {
+            token_reserve(c, cached->token_count);
+            if (cached->token_count > 0) {
+                memcpy(&c->tokens[first_token], cached->tokens, sizeof(Token) * cached->token_count);
             }
-            switch (dyn_char_get(line, *i)) {
-            case '(': {
-                if (paren_nest_level >= MAX_PAREN_NESTING) {
-                    return ERROR_NESTING_TOO_DEEP;
-                }
-                Token *token = token_add(c, TOKEN_PAREN_OPEN);
-                token->value.int_number = -1;
-                paren_open_addresses[paren_nest_level] = token->address;
-                paren_nest_level += 1;
-            } break;
-            case ')': {
-                paren_nest_level -= 1;
-                if (paren_nest_level < 0) {
-                    return ERROR_NO_MATCHING_OPENING_PAREN;
-                }
-                Token *token = token_add(c, TOKEN_PAREN_CLOSE);
-                int paren_open_address = paren_open_addresses[paren_nest_level];
-                token->value.int_number = paren_open_address;
-                c->tokens[paren_open_address].value.int_number = token->address;
-            } break;
-            default: {
-                if (try_get_note_token(c)) {
-                    break;
-                }
-                if (try_get_play_or_wait_token(c)) {
-                    break;
-                }
-                if (is_numeric(dyn_char_get(line, *i))) {
-                    Compiler_Error str_to_int_error = NO_ERROR;
-                    int number = str_to_int(line, *i, &str_to_int_error);
-                    if (str_to_int_error != NO_ERROR) {
-                        return str_to_int_error;;
-                    }
-                    Token *token = token_add(c, TOKEN_NUMBER);
-                    token->value.int_number = number;
-                    *i += (digit_count(number) - 1);
-                    break;
-                }
-                if (!is_valid_in_identifier(dyn_char_get(line, *i))) {
-                    return ERROR_SYNTAX_ERROR;
-                }
-                int ident_length = 0;
-                for (int j = *i; is_valid_in_identifier(dyn_char_get(line, j)); j++) {
-                    ident_length++;
-                }
-                char ident[1024];
-                for (int j = 0; j < ident_length; j++) {
-                    ident[j] = dyn_char_get(line, *i + j);
-                }
-                ident[ident_length] = '\0';
-                if (strcmp("start", ident) == 0) {
-                    token_add(c, TOKEN_START);
-                } else if (strcmp("sine", ident) == 0) {
-                    token_add(c, TOKEN_SINE);
-                } else if (strcmp("triangle", ident) == 0) {
-                    token_add(c, TOKEN_TRIANGLE);
-                } else if (strcmp("square", ident) == 0) {
-                    token_add(c, TOKEN_SQUARE);
-                } else if (strcmp("sawtooth", ident) == 0) {
-                    token_add(c, TOKEN_SAWTOOTH);
-                } else if (strcmp("semi", ident) == 0) {
-                    token_add(c, TOKEN_SEMI);
-                } else if (strcmp("play", ident) == 0) {
-                    token_add(c, TOKEN_PLAY);
-                } else if (strcmp("wait", ident) == 0) {
-                    token_add(c, TOKEN_WAIT);
-                } else if (strcmp("bpm", ident) == 0) {
-                    token_add(c, TOKEN_BPM);
-                } else if (strcmp("chord", ident) == 0) {
-                    token_add(c, TOKEN_CHORD);
-                } else if (strcmp("scale", ident) == 0) {
-                    token_add(c, TOKEN_SCALE);
-                } else if (strcmp("rise", ident) == 0) {
-                    token_add(c, TOKEN_RISE);
-                } else if (strcmp("fall", ident) == 0) {
-                    token_add(c, TOKEN_FALL);
-                } else if (strcmp("repeat", ident) == 0) {
-                    token_add(c, TOKEN_REPEAT);
-                } else if (strcmp("rounds", ident) == 0) {
-                    token_add(c, TOKEN_ROUNDS);
-                } else if (strcmp("forever", ident) == 0) {
-                    token_add(c, TOKEN_FOREVER);
-                } else if (strcmp("define", ident) == 0) {
-                    token_add(c, TOKEN_DEFINE);
-                } else {
-                    Token *token = token_add(c, TOKEN_IDENTIFIER);
-                    token->value.string = (char *)dyn_mem_alloc(sizeof(char) * (ident_length + 1));
-                    if (token->value.string == NULL) {
-                        thread_error();
-                    }
-                    strcpy(token->value.string, ident);
-                }
-                *i += (ident_length - 1);
-            } break;
+            c->token_amount += cached->token_count;
+            line_error = cached->error;
+            error_char_idx = cached->error_char_idx;
+        } else {
+            line_error = lexer_line(c);
+            error_char_idx = c->char_idx;
+            if (cached != NULL) {
+                lex_line_store(cached, &c->tokens[first_token], c->token_amount - first_token, line_error, error_char_idx);
             }
         }
+
+        // the tokens before an error on the line come first, so do their paren errors
+        Compiler_Error link_error = lexer_link_line(c, first_token, &parens);
+        if (link_error != NO_ERROR) {
+            return link_error;
+        }
+        if (line_error != NO_ERROR) {
+            c->char_idx = error_char_idx;
+            return line_error;
+        }
     }
 
     return NO_ERROR;
@@ -1,191 +1,341 @@
 #include "../main.h"
 #include "compiler_utils.c"
 
-inline static float note_to_frequency(int semi_offset) {
-    return A4_FREQ * powf(2.0f, (float)semi_offset / (float)OCTAVE);
-}
-
-static void parser_init(Parser *parser) {
-    parser->token_idx = 0;
-    parser->nest_idx = -1;
-    for (int i = 0; i < 16; i++) {
-        parser->nest_repetitions[i].target = -1;
-        parser->nest_repetitions[i].round = 0;
-    }
+// with a start marker the parser seeks, everything up to the first start that runs only changes its state.
+// A start that never runs does not keep it seeking, it plays the whole program from the beginning then
+static void parser_init(Parser *parser, bool is_seeking) {
+    parser->pc = 0;
+    parser->is_seeking = is_seeking;
+    parser->seek_skipped_tones = 0;
+    parser->seek_snapshot_length = 0;
+    parser->seek_jump_count = 0;
+    parser->seek_until_seconds = -1.0;
+    parser->elapsed_seconds = 0.0;
+    parser->loop_count = 0;
+    parser->return_count = 0;
     parser->current_bpm = 125;
     parser->current_waveform = WAVEFORM_SINE;
-    parser->token_ptr_return_idx = 0;
     parser->current_chord = SILENT_CHORD;
     parser->current_chord.size = 1;
     parser->current_scale = ~0;
 }
 
-static void parser_run(Compiler *compiler) {
-    Parser *parser = &compiler->parser;
-    Token* tokens = compiler->tokens;
+static void parser_free(Parser *parser) {
+    if (parser->loops != NULL) {
+        dyn_mem_release(parser->loops);
+    }
+    if (parser->returns != NULL) {
+        dyn_mem_release(parser->returns);
+    }
+    if (parser->seek_snapshot != NULL) {
+        dyn_mem_release(parser->seek_snapshot);
+    }
+    *parser = (Parser){0};
+}
+
+// loops and calls can nest as deep as the program recurses, so both stacks grow
+static void parser_stack_grow(void **data, int *capacity, int element_size) {
+    *capacity = *capacity == 0 ? 16 : *capacity * 2;
+    *data = dyn_mem_realloc(*data, (size_t)*capacity * element_size);
+    if (*data == NULL) {
+        thread_error();
+    }
+}
 
-    compiler->tone_amount = 0;
+static void parser_stack_reserve(void **data, int *capacity, int count, int element_size) {
+    while (*capacity < count) {
+        parser_stack_grow(data, capacity, element_size);
+    }
+}
+
+// where the program goes only depends on the pc and the stacks, never on bpm or notes. So once they
+// are the same at a jump back as they were at an earlier one, the seek goes round in circles and the
+// start is never reached. The snapshot is taken again each time the jump count reaches a power of two,
+// which finds any period as soon as the count has reached twice its length
+static bool parser_seek_repeats(Parser *parser, int pc) {
+    int length = 3 + 2 * parser->loop_count + parser->return_count;
+    int *snapshot = parser->seek_snapshot;
+    bool is_same =
+        parser->seek_snapshot_length == length &&
+        snapshot[0] == pc &&
+        snapshot[1] == parser->loop_count &&
+        snapshot[2] == parser->return_count;
+    for (int i = 0; is_same && i < parser->loop_count; i++) {
+        is_same = snapshot[3 + 2 * i] == parser->loops[i].target && snapshot[4 + 2 * i] == parser->loops[i].round;
+    }
+    for (int i = 0; is_same && i < parser->return_count; i++) {
+        is_same = snapshot[3 + 2 * parser->loop_count + i] == parser->returns[i];
+    }
+    if (is_same) {
+        return true;
+    }
+
+    parser->seek_jump_count++;
+    if ((parser->seek_jump_count & (parser->seek_jump_count - 1)) == 0) {
+        parser_stack_reserve((void **)&parser->seek_snapshot, &parser->seek_snapshot_capacity, length, sizeof(int));
+        snapshot = parser->seek_snapshot;
+        snapshot[0] = pc;
+        snapshot[1] = parser->loop_count;
+        snapshot[2] = parser->return_count;
+        for (int i = 0; i < parser->loop_count; i++) {
+            snapshot[3 + 2 * i] = parser->loops[i].target;
+            snapshot[4 + 2 * i] = parser->loops[i].round;
+        }
+        for (int i = 0; i < parser->return_count; i++) {
+            snapshot[3 + 2 * parser->loop_count + i] = parser->returns[i];
+        }
+        parser->seek_snapshot_length = length;
+    }
+    return false;
+}
+
+static void parser_checkpoint_save(Parser_Checkpoints *checkpoints, Parser *parser) {
+    parser_stack_reserve((void **)&checkpoints->items, &checkpoints->capacity, checkpoints->count + 1, sizeof(Parser_Checkpoint));
+    parser_stack_reserve((void **)&checkpoints->loops, &checkpoints->loop_capacity, checkpoints->loop_count + parser->loop_count, sizeof(Repetition));
+    parser_stack_reserve((void **)&checkpoints->returns, &checkpoints->return_capacity, checkpoints->return_count + parser->return_count, sizeof(int));
+
+    Parser_Checkpoint *checkpoint = &checkpoints->items[checkpoints->count++];
+    checkpoint->elapsed_seconds = parser->elapsed_seconds;
+    checkpoint->pc = parser->pc;
+    checkpoint->loop_first = checkpoints->loop_count;
+    checkpoint->loop_count = parser->loop_count;
+    checkpoint->return_first = checkpoints->return_count;
+    checkpoint->return_count = parser->return_count;
+    checkpoint->current_bpm = parser->current_bpm;
+    checkpoint->current_waveform = parser->current_waveform;
+    checkpoint->current_chord = parser->current_chord;
+    checkpoint->current_scale = parser->current_scale;
+
+    for (int i = 0; i < parser->loop_count; i++) {
+        checkpoints->loops[checkpoints->loop_count++] = parser->loops[i];
+    }
+    for (int i = 0; i < parser->return_count; i++) {
+        checkpoints->returns[checkpoints->return_count++] = parser->returns[i];
+    }
+}
+
+static void parser_checkpoint_restore(Parser *parser, Parser_Checkpoints *checkpoints, int checkpoint_idx) {
+    Parser_Checkpoint *checkpoint = &checkpoints->items[checkpoint_idx];
+    parser_stack_reserve((void **)&parser->loops, &parser->loop_capacity, checkpoint->loop_count, sizeof(Repetition));
+    parser_stack_reserve((void **)&parser->returns, &parser->return_capacity, checkpoint->return_count, sizeof(int));
+
+    parser_init(parser, false);
+    parser->elapsed_seconds = checkpoint->elapsed_seconds;
+    parser->pc = checkpoint->pc;
+    parser->loop_count = checkpoint->loop_count;
+    parser->return_count = checkpoint->return_count;
+    parser->current_bpm = checkpoint->current_bpm;
+    parser->current_waveform = checkpoint->current_waveform;
+    parser->current_chord = checkpoint->current_chord;
+    parser->current_scale = checkpoint->current_scale;
+
+    for (int i = 0; i < checkpoint->loop_count; i++) {
+        parser->loops[i] = checkpoints->loops[checkpoint->loop_first + i];
+    }
+    for (int i = 0; i < checkpoint->return_count; i++) {
+        parser->returns[i] = checkpoints->returns[checkpoint->return_first + i];
+    }
+}
+
+// the last checkpoint at or before the time, -1 when there is none
+static int parser_checkpoint_find(Parser_Checkpoints *checkpoints, double seconds) {
+    int low = 0;
+    int high = checkpoints->count;
+    while (low < high) {
+        int middle = low + (high - low) / 2;
+        if (checkpoints->items[middle].elapsed_seconds <= seconds) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    return low - 1;
+}
+
+static void parser_checkpoints_free(Parser_Checkpoints *checkpoints) {
+    if (checkpoints->items != NULL) {
+        dyn_mem_release(checkpoints->items);
+    }
+    if (checkpoints->loops != NULL) {
+        dyn_mem_release(checkpoints->loops);
+    }
+    if (checkpoints->returns != NULL) {
+        dyn_mem_release(checkpoints->returns);
+    }
+    parser_free(&checkpoints->recorder);
+    *checkpoints = (Parser_Checkpoints){0};
+}
+
+// runs the bytecode until SYNTHESIZER_TONE_CAPACITY tones are ready or the program ends.
+// given checkpoints the parser is their recorder instead: it emits nothing and saves a checkpoint
+// every PARSER_CHECKPOINT_INTERVAL_SECONDS of music until it gets past record_until_seconds
+static void parser_execute(Compiler *compiler, Parser *parser, Parser_Checkpoints *checkpoints, double record_until_seconds) {
+    Instruction *instructions = compiler->bytecode.instructions;
+
+    if (checkpoints == NULL) {
+        compiler->tone_amount = 0;
+    }
 
     int tone_idx = 0;
-    bool semi_flag = false;
+    int pc = parser->pc;
 
-    for (int i = parser->token_idx; i < compiler->token_amount; i++) {
-        switch (tokens[i].type) {
+    while (true) {
+        Instruction *instruction = &instructions[pc++];
+        switch (instruction->opcode) {
         default:
             ASSERT(false);
             break;
-        case TOKEN_PLAY:
-        case TOKEN_WAIT: {
+        case OP_HALT: {
+            if (parser->is_seeking && parser->seek_until_seconds < 0.0) {
+                parser_init(parser, false);
+                pc = 0;
+                break;
+            }
+            parser->pc = pc - 1;
+            if (checkpoints != NULL) {
+                checkpoints->is_complete = true;
+            } else {
+                compiler->flags &= ~COMPILER_FLAG_IN_PROCESS;
+            }
+            return;
+        }
+        case OP_EMIT_TONE: {
+            float duration = instruction->as.tone.duration * 240.0f / parser->current_bpm;
+            if (checkpoints != NULL) {
+                parser->pc = pc - 1;
+                if (parser->elapsed_seconds > record_until_seconds) {
+                    return;
+                }
+                if (
+                    checkpoints->count == 0 ||
+                    parser->elapsed_seconds >= checkpoints->items[checkpoints->count - 1].elapsed_seconds + PARSER_CHECKPOINT_INTERVAL_SECONDS
+                ) {
+                    parser_checkpoint_save(checkpoints, parser);
+                }
+                parser->elapsed_seconds += duration;
+                break;
+            }
+            if (parser->is_seeking) {
+                if (parser->seek_until_seconds < 0.0 || parser->elapsed_seconds < parser->seek_until_seconds) {
+                    parser->elapsed_seconds += duration;
+                    // a start behind a recursion without end is never reached either
+                    parser->seek_skipped_tones++;
+                    if (parser->seek_until_seconds < 0.0 && parser->seek_skipped_tones == PARSER_SEEK_MAX_TONES) {
+                        parser_init(parser, false);
+                        pc = 0;
+                    }
+                    break;
+                }
+                parser->is_seeking = false;
+            }
+            parser->elapsed_seconds += duration;
             Tone* tone = &compiler->tones[compiler->tone_amount];
-            tone->waveform = tokens[i].type == TOKEN_PLAY
+            tone->waveform = instruction->as.tone.is_play
                 ? parser->current_waveform
                 : WAVEFORM_NONE;
             tone->token_idx = tone_idx++;
-            tone->line_idx = tokens[i].line_number;
-            tone->char_idx = tokens[i].char_index;
-            tone->char_count = tokens[i].value.play_or_wait.char_count;
-            tone->chord = tokens[i].type == TOKEN_PLAY
+            tone->line_idx = instruction->as.tone.line_idx;
+            tone->char_idx = instruction->as.tone.char_idx;
+            tone->char_count = instruction->as.tone.char_count;
+            tone->chord = instruction->as.tone.is_play
                 ? parser->current_chord
                 : INVALID_CHORD;
             for (int i = 0; i < parser->current_chord.size; i++) {
-                tone->chord.frequencies[i] = note_to_frequency(parser->current_chord.notes[i]);
+                tone->chord.frequencies[i] = note_frequency(parser->current_chord.notes[i]);
             }
-            tone->duration = tokens[i].value.play_or_wait.duration * 240.0f / parser->current_bpm;
+            tone->duration = duration;
             compiler->tone_amount++;
             if (compiler->tone_amount == SYNTHESIZER_TONE_CAPACITY) {
-                compiler->flags |= COMPILER_FLAG_OUTPUT_AVAILABLE;
-                compiler->parser.token_idx = (i + 1);
+                parser->pc = pc;
                 return;
             }
         } break;
-        case TOKEN_START: {
-            int old_idx = tone_idx + 1;
-            int new_idx = 0;
-            while (old_idx < compiler->tone_amount) {
-                compiler->tones[new_idx] = compiler->tones[old_idx];
-                old_idx++;
-                new_idx++;
+        case OP_START: {
+            if (parser->seek_until_seconds < 0.0) {
+                parser->is_seeking = false;
             }
-            compiler->tone_amount = new_idx;
         } break;
-        case TOKEN_SINE:        { parser->current_waveform = WAVEFORM_SINE; } break;
-        case TOKEN_TRIANGLE:    { parser->current_waveform = WAVEFORM_TRIANGLE; } break;
-        case TOKEN_SQUARE:      { parser->current_waveform = WAVEFORM_SQUARE; } break;
-        case TOKEN_SAWTOOTH:    { parser->current_waveform = WAVEFORM_SAWTOOTH; } break;
-        case TOKEN_SEMI: {
-            semi_flag = true;
+        case OP_SET_WAVEFORM: {
+            parser->current_waveform = (Waveform)instruction->as.number;
         } break;
-        case TOKEN_BPM: {
-            i += 1;
-            parser->current_bpm = tokens[i].value.int_number;
+        case OP_SET_BPM: {
+            parser->current_bpm = instruction->as.number;
         } break;
-        case TOKEN_NOTE: {
+        case OP_SET_NOTE: {
             parser->current_chord.size = 1;
-            parser->current_chord.notes[0] = tokens[i].value.int_number;
+            parser->current_chord.notes[0] = instruction->as.number;
         } break;
-        case TOKEN_RISE:
-        case TOKEN_FALL: {
-            int direction = (tokens[i].type == TOKEN_RISE) ? 1 : -1;
-            int scale = semi_flag ? CHROMATIC_SCALE : parser->current_scale;
-            semi_flag = false;
-            Token *peek_token_ptr;
-            int offset = 1; // default offset
-            if (peek_token(compiler, i, 1, &peek_token_ptr) && peek_token_ptr->type == TOKEN_NUMBER) {
-                i++;
-                offset = peek_token_ptr->value.int_number;
-            }
-            for (int i = 0; i < parser->current_chord.size; i++) {
-                for (int j = 0; j < offset; j += 1) {
-                    parser->current_chord.notes[i] += direction;
-                    while (true) {
-                        int note_flag = get_note_flag(parser->current_chord.notes[i]);
-                        if (has_flag(scale, note_flag)) {
-                            break;
-                        }
-                        parser->current_chord.notes[i] += direction;
-                    }
-                }
-            }
+        case OP_SET_CHORD: {
+            parser->current_chord = compiler->bytecode.chords[instruction->as.number];
         } break;
-        case TOKEN_CHORD: {
-            i += 2;
-            parser->current_chord = get_chord(compiler->token_amount, tokens, &i, NULL);
+        case OP_SET_SCALE: {
+            parser->current_scale = instruction->as.number;
         } break;
-        case TOKEN_SCALE: {
-            i += 2;
-            parser->current_scale = get_scale(compiler->token_amount, tokens, &i, NULL);
-        } break;
-        case TOKEN_REPEAT: {
-            i++;
-            int repeat_amount = tokens[i].value.int_number;
-            parser->nest_idx += 1;
-            parser->nest_repetitions[parser->nest_idx].target = repeat_amount;
-            parser->nest_repetitions[parser->nest_idx].round = 0;
-            i++;
+        case OP_TRANSPOSE: {
+            int direction = instruction->as.transpose.direction;
+            int scale = instruction->as.transpose.is_chromatic ? CHROMATIC_SCALE : parser->current_scale;
+            int steps = instruction->as.transpose.steps;
+            for (int i = 0; i < parser->current_chord.size; i++) {
+                int8 *note = &parser->current_chord.notes[i];
+                *note = note_transpose(*note, scale, direction, steps);
+            }
         } break;
-        case TOKEN_FOREVER: {
-            i++;
+        case OP_LOOP: {
+            if (parser->loop_count == parser->loop_capacity) {
+                parser_stack_grow((void **)&parser->loops, &parser->loop_capacity, sizeof(Repetition));
+            }
+            parser->loops[parser->loop_count++] = (Repetition){
+                .target = instruction->as.number,
+                .round = 0,
+            };
         } break;
-        case TOKEN_ROUNDS: {
-            int rounds[16] = {0};
-            int amount = tokens[i].value.int_number;
-            for (int j = 0; j < amount; j++) {
-                rounds[j] = tokens[i + j + 1].value.int_number;
+        case OP_END_LOOP: {
+            // the body always runs at least once, "repeat 0" plays like "repeat 1"
+            Repetition *rep = &parser->loops[parser->loop_count - 1];
+            rep->round++;
+            if (rep->round < rep->target) {
+                pc = instruction->as.target;
+            } else {
+                parser->loop_count--;
             }
-            i += amount;
-            i++;
+        } break;
+        case OP_ROUNDS: {
+            // refers to the innermost repeat that is running, outside of one no round matches
+            int round = parser->loop_count > 0 ? parser->loops[parser->loop_count - 1].round : -1;
+            int *round_numbers = &compiler->bytecode.round_numbers[instruction->as.rounds.first];
             bool special_round = false;
-            for (int j = 0; j < amount; j++) {
-                if ((rounds[j] - 1) == parser->nest_repetitions[parser->nest_idx].round) {
+            for (int j = 0; j < instruction->as.rounds.count; j++) {
+                if ((round_numbers[j] - 1) == round) {
                     special_round = true;
                     break;
                 }
             }
             if (!special_round) {
-                int paren_close_address = tokens[i].value.int_number;
-                i = paren_close_address;
+                pc = instruction->as.rounds.end;
             }
         } break;
-        case TOKEN_DEFINE: {
-            i += 2;
-            int paren_close_address = tokens[i].value.int_number;
-            i = paren_close_address;
-        } break;
-        case TOKEN_IDENTIFIER: {
-            for (int j = 0; j < compiler->variable_count; j++) {
-                if (strcmp(tokens[i].value.string, compiler->variables[j].ident) == 0) {
-                    parser->token_ptr_return_positions[parser->token_ptr_return_idx] = i;
-                    parser->token_ptr_return_idx += 1;
-                    i = compiler->variables[j].address;
-                    break;
-                }
+        case OP_JUMP: {
+            bool is_back = instruction->as.target < pc;
+            pc = instruction->as.target;
+            if (is_back && parser->is_seeking && parser->seek_until_seconds < 0.0 && parser_seek_repeats(parser, pc)) {
+                parser_init(parser, false);
+                pc = 0;
             }
         } break;
-        case TOKEN_PAREN_CLOSE: {
-            int paren_return_address = tokens[i].value.int_number;
-            if (paren_return_address < 1) {
-                break;
-            }
-            if (TOKEN_REPEAT == tokens[paren_return_address - 2].type) {
-                Repetition *rep = &parser->nest_repetitions[parser->nest_idx];
-                rep->round++;
-                if (rep->round < rep->target) {
-                    int paren_open_idx = tokens[i].value.int_number;
-                    i = paren_open_idx;
-                } else {
-                    rep->target = -1;
-                    rep->round = 0;
-                    parser->nest_idx -= 1;
-                }
-            } else if (TOKEN_FOREVER == tokens[paren_return_address - 1].type) {
-                i = paren_return_address;
-            } else if (TOKEN_DEFINE == tokens[paren_return_address - 2].type) {
-                parser->token_ptr_return_idx--;
-                i = parser->token_ptr_return_positions[parser->token_ptr_return_idx];
+        case OP_CALL: {
+            if (parser->return_count == parser->return_capacity) {
+                parser_stack_grow((void **)&parser->returns, &parser->return_capacity, sizeof(int));
             }
+            parser->returns[parser->return_count++] = pc;
+            pc = instruction->as.target;
+        } break;
+        case OP_RET: {
+            pc = parser->returns[--parser->return_count];
         } break;
         }
     }
+}
 
-    compiler->flags &= ~COMPILER_FLAG_IN_PROCESS;
+static void parser_run(Compiler *compiler) {
+    parser_execute(compiler, &compiler->parser, NULL, 0.0);
 }
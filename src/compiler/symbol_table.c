@@ -0,0 +1,99 @@
+#ifndef SYMBOL_TABLE_C
+#define SYMBOL_TABLE_C
+
+#include "../main.h"
+
+// every distinct identifier is stored once and gets the index of its symbol as id,
+// tokens only carry the id so nothing after the lexer has to compare names
+// the table is gone with the arena, there is nothing to free one by one
+static void symbol_table_init(Symbol_Table *table, Arena *arena) {
+    table->arena = arena;
+    table->symbol_count = 0;
+    table->symbol_capacity = SYMBOL_TABLE_INITIAL_CAPACITY;
+    table->symbols = (Symbol *)arena_alloc(arena, sizeof(Symbol) * table->symbol_capacity);
+    // kept at twice the symbol capacity so the open addressing never gets more than half full
+    table->slot_capacity = SYMBOL_TABLE_INITIAL_CAPACITY * 2;
+    table->slots = (int *)arena_alloc_zero(arena, sizeof(int) * table->slot_capacity);
+    if (table->symbols == NULL || table->slots == NULL) {
+        thread_error();
+    }
+}
+
+static uint32 symbol_table_hash(const char *name, int length) {
+    // FNV-1a
+    uint32 hash = 2166136261u;
+    for (int i = 0; i < length; i++) {
+        hash ^= (unsigned char)name[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// slots hold symbol id + 1 so a zeroed slot is empty, the capacity is a power of two
+inline static int *symbol_table_find_slot(Symbol_Table *table, const char *name, int length, uint32 hash) {
+    uint32 mask = (uint32)table->slot_capacity - 1;
+    for (uint32 idx = hash & mask;; idx = (idx + 1) & mask) {
+        int *slot = &table->slots[idx];
+        if (*slot == 0) {
+            return slot;
+        }
+        Symbol *symbol = &table->symbols[*slot - 1];
+        if (symbol->hash == hash && symbol->length == length && memcmp(symbol->name, name, length) == 0) {
+            return slot;
+        }
+    }
+}
+
+static void symbol_table_grow(Symbol_Table *table) {
+    table->symbols = (Symbol *)arena_grow(
+        table->arena,
+        table->symbols,
+        sizeof(Symbol) * table->symbol_capacity,
+        sizeof(Symbol) * table->symbol_capacity * 2
+    );
+    table->symbol_capacity *= 2;
+
+    table->slot_capacity = table->symbol_capacity * 2;
+    table->slots = (int *)arena_alloc_zero(table->arena, sizeof(int) * table->slot_capacity);
+    if (table->symbols == NULL || table->slots == NULL) {
+        thread_error();
+    }
+    for (int i = 0; i < table->symbol_count; i++) {
+        Symbol *symbol = &table->symbols[i];
+        *symbol_table_find_slot(table, symbol->name, symbol->length, symbol->hash) = i + 1;
+    }
+}
+
+// returns the id of the identifier, adding it the first time it is seen
+static int symbol_table_intern_hashed(Symbol_Table *table, const char *name, int length, uint32 hash) {
+    int *slot = symbol_table_find_slot(table, name, length, hash);
+    if (*slot != 0) {
+        return *slot - 1;
+    }
+
+    if (table->symbol_count == table->symbol_capacity) {
+        symbol_table_grow(table);
+        slot = symbol_table_find_slot(table, name, length, hash);
+    }
+    int id = table->symbol_count;
+    Symbol *symbol = &table->symbols[id];
+    symbol->name = (char *)arena_alloc(table->arena, sizeof(char) * (length + 1));
+    if (symbol->name == NULL) {
+        thread_error();
+    }
+    memcpy(symbol->name, name, length);
+    symbol->name[length] = '\0';
+    symbol->length = length;
+    symbol->hash = hash;
+    symbol->define_address = -1;
+    table->symbol_count++;
+    *slot = id + 1;
+    return id;
+}
+
+inline static Symbol *symbol_table_get(Symbol_Table *table, int id) {
+    ASSERT(id >= 0 && id < table->symbol_count);
+    return &table->symbols[id];
+}
+
+#endif
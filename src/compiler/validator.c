@@ -23,7 +23,9 @@ static Compiler_Error_Address validator_run(Compiler *c) {
         }
     }
 
-    c->variable_count = 0;
+    for (int i = 0; i < c->symbols.symbol_count; i++) {
+        c->symbols.symbols[i].define_address = -1;
+    }
 
     Token *peek_token_ptr;
 
@@ -124,31 +126,23 @@ static Compiler_Error_Address validator_run(Compiler *c) {
                 return validator_error(ERROR_EXPECTED_IDENTIFIER, i);
             }
             i++;
-            int variable_idx = c->variable_count;
-            for (int j = 0; j < c->variable_count; j++) {
-                if (strcmp(tokens[i].value.string, c->variables[j].ident) == 0) {
-                    return validator_error(ERROR_MULTIPLE_DEFINITIONS, i);
-                }
-            }
-            c->variables[variable_idx].ident = tokens[i].value.string;
-            c->variable_count++;
+            Symbol *symbol = symbol_table_get(&c->symbols, tokens[i].value.identifier.symbol_id);
+            if (symbol->define_address >= 0) {
+                return validator_error(ERROR_MULTIPLE_DEFINITIONS, i);
+            }
             if (!peek_token(c, i, 1, &peek_token_ptr) || peek_token_ptr->type != TOKEN_PAREN_OPEN) {
                 return validator_error(ERROR_EXPECTED_PAREN_OPEN, i);
             }
             i++;
-            c->variables[variable_idx].address = tokens[i].address;
+            symbol->define_address = tokens[i].address;
         } break;
         case TOKEN_IDENTIFIER: {
-            bool known_identifier = false;
-            for (int j = 0; j < c->variable_count; j++) {
-                if (strcmp(tokens[i].value.string, c->variables[j].ident) == 0) {
-                    known_identifier = true;
-                    break;
-                }
-            }
-            if (!known_identifier) {
+            // a call has to come after its define, resolving it here leaves the parser a plain jump
+            Symbol *symbol = symbol_table_get(&c->symbols, tokens[i].value.identifier.symbol_id);
+            if (symbol->define_address < 0) {
                 return validator_error(ERROR_UNKNOWN_IDENTIFIER, i);
             }
+            tokens[i].value.identifier.define_address = symbol->define_address;
         } break;
         default: {
             return validator_error(ERROR_SYNTAX_ERROR, i);
@@ -1,66 +1,140 @@
 #ifndef DYN_MEMORY_H
 #define DYN_MEMORY_H
 
+// what an allocation lives for, debug builds count the live allocations of each
+typedef enum Dyn_Mem_Tag {
+    // released one by one with dyn_mem_release
+    DYN_MEM_TAG_HEAP,
+    // chunks of a compiler's arena, everything of one compile goes at once
+    DYN_MEM_TAG_COMPILE,
+    DYN_MEM_TAG_COUNT,
+} Dyn_Mem_Tag;
+
 #ifdef DEBUG
 #include <stdio.h>
-static int global_allocations = 0;
+static int dyn_mem_allocations[DYN_MEM_TAG_COUNT] = {0};
 #ifdef VERBOSE
     static void print_allocations(const char *name) {
+        static const char *tag_names[DYN_MEM_TAG_COUNT] = { "heap", "compile" };
         reset_console_color();
         printf("(");
         set_console_color(CONSOLE_FG_BLUE);
         printf("%s", name);
         reset_console_color();
-        printf(") : ");
-        set_console_color(CONSOLE_FG_YELLOW);
-        printf("%i global allocations\n", global_allocations);
+        printf(") :");
+        for (int i = 0; i < DYN_MEM_TAG_COUNT; i++) {
+            set_console_color(CONSOLE_FG_YELLOW);
+            printf(" %i", __atomic_load_n(&dyn_mem_allocations[i], __ATOMIC_RELAXED));
+            reset_console_color();
+            printf(" %s", tag_names[i]);
+        }
+        printf(" allocations\n");
         reset_console_color();
     }
     #define PRINT_ALLOCATIONS(NAME) print_allocations(NAME)
 #else
     #define PRINT_ALLOCATIONS(NAME)
 #endif
+    // the checker and the render workers allocate next to the main thread
+    #define DYN_MEM_COUNT(TAG, DELTA, NAME) do { \
+        __atomic_add_fetch(&dyn_mem_allocations[TAG], DELTA, __ATOMIC_RELAXED); \
+        PRINT_ALLOCATIONS(NAME); \
+    } while (0)
+#else
+    #define DYN_MEM_COUNT(TAG, DELTA, NAME)
 #endif
 
-inline static void *dyn_mem_alloc(int size) {
-    #ifdef DEBUG
-        global_allocations++;
-        void *m = malloc(size);
-        PRINT_ALLOCATIONS("MALLOC");
-        return m;
+#ifdef DYN_MEM_TRACK_BYTES
+// every block carries its size in front of it, 16 bytes keep the block itself aligned like malloc
+#define DYN_MEM_HEADER_SIZE 16
+static long long dyn_mem_current_bytes = 0;
+static long long dyn_mem_peak_bytes = 0;
+// every malloc, calloc and realloc, the benchmark expects none once playback is warmed up
+static long long dyn_mem_allocation_count = 0;
+
+static void dyn_mem_track(long long delta) {
+    long long current = __atomic_add_fetch(&dyn_mem_current_bytes, delta, __ATOMIC_RELAXED);
+    long long peak = __atomic_load_n(&dyn_mem_peak_bytes, __ATOMIC_RELAXED);
+    while (current > peak && !__atomic_compare_exchange_n(&dyn_mem_peak_bytes, &peak, current, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+}
+
+// the peak is measured from here on
+static void dyn_mem_reset_peak() {
+    __atomic_store_n(&dyn_mem_peak_bytes, __atomic_load_n(&dyn_mem_current_bytes, __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+}
+
+static void *dyn_mem_track_block(void *block, int size) {
+    if (block == NULL) {
+        return NULL;
+    }
+    *(long long *)block = size;
+    dyn_mem_track(size);
+    __atomic_add_fetch(&dyn_mem_allocation_count, 1, __ATOMIC_RELAXED);
+    return (char *)block + DYN_MEM_HEADER_SIZE;
+}
+
+inline static void *dyn_mem_block(void *m) {
+    return m == NULL ? NULL : (char *)m - DYN_MEM_HEADER_SIZE;
+}
+
+inline static long long dyn_mem_block_size(void *m) {
+    return m == NULL ? 0 : *(long long *)dyn_mem_block(m);
+}
+#endif
+
+inline static void *dyn_mem_alloc_tagged(int size, Dyn_Mem_Tag tag) {
+    (void)tag;
+    DYN_MEM_COUNT(tag, 1, "MALLOC");
+    #ifdef DYN_MEM_TRACK_BYTES
+        return dyn_mem_track_block(malloc(size + DYN_MEM_HEADER_SIZE), size);
     #else
         return malloc(size);
     #endif
 }
 
+inline static void *dyn_mem_alloc(int size) {
+    return dyn_mem_alloc_tagged(size, DYN_MEM_TAG_HEAP);
+}
+
 inline static void *dyn_mem_alloc_zero(int size) {
-    #ifdef DEBUG
-        global_allocations++;
-        void *m = calloc(1, size);
-        PRINT_ALLOCATIONS("CALLOC");
-        return m;
+    DYN_MEM_COUNT(DYN_MEM_TAG_HEAP, 1, "CALLOC");
+    #ifdef DYN_MEM_TRACK_BYTES
+        return dyn_mem_track_block(calloc(1, size + DYN_MEM_HEADER_SIZE), size);
     #else
         return calloc(1, size);
     #endif
 }
 
+// keeps the contents up to the smaller of the two sizes, NULL allocates a new block
 inline static void *dyn_mem_realloc(void *m, int size) {
-    #ifdef DEBUG
-        m = realloc(m, size);
-        PRINT_ALLOCATIONS("REALLOC");
-        return m;
+    if (m == NULL) {
+        DYN_MEM_COUNT(DYN_MEM_TAG_HEAP, 1, "REALLOC");
+    }
+    #ifdef DYN_MEM_TRACK_BYTES
+        long long old_size = dyn_mem_block_size(m);
+        void *block = realloc(dyn_mem_block(m), size + DYN_MEM_HEADER_SIZE);
+        if (block == NULL) {
+            return NULL;
+        }
+        dyn_mem_track(-old_size);
+        return dyn_mem_track_block(block, size);
     #else
-        (void)m;
-        return calloc(1, size);
+        return realloc(m, size);
     #endif
 }
 
-inline static void dyn_mem_release(void *m) {
-    #ifdef DEBUG
-        global_allocations--;
-        PRINT_ALLOCATIONS("FREE");
+inline static void dyn_mem_release_tagged(void *m, Dyn_Mem_Tag tag) {
+    (void)tag;
+    DYN_MEM_COUNT(tag, -1, "FREE");
+    #ifdef DYN_MEM_TRACK_BYTES
+        dyn_mem_track(-dyn_mem_block_size(m));
+        m = dyn_mem_block(m);
     #endif
     free(m);
 }
 
+inline static void dyn_mem_release(void *m) {
+    dyn_mem_release_tagged(m, DYN_MEM_TAG_HEAP);
+}
+
 #endif
@@ -88,7 +88,10 @@ Big_State editor_input(State *state) {
             }
         }
         if (ctrl && IsKeyPressed(KEY_P)) {
-            return STATE_TRY_COMPILE;
+            return shift ? STATE_TRY_COMPILE_FROM_CURSOR : STATE_TRY_COMPILE;
+        }
+        if (ctrl && IsKeyPressed(KEY_I)) {
+            return STATE_TRY_ANALYZE;
         }
         if (ctrl && auto_click(state, KEY_Z)) {
             undo(state);
@@ -206,6 +209,7 @@ Big_State editor_input(State *state) {
                     int line_idx = start_line + i;
                     DynArray *line = dyn_array_get(&e->lines, line_idx);
                     dyn_array_remove(line, 0, spaces[i]);
+                    lex_cache_line_changed(&e->lex_cache, line_idx);
                     set_cursor_x(state, e->cursor.x - spaces[i]);
                 }
             } else {
@@ -248,7 +252,8 @@ Big_State editor_input(State *state) {
         }
     } break;
     case STATE_EDITOR_SAVE_FILE:
-    case STATE_EDITOR_SAVE_FILE_ERROR: {
+    case STATE_EDITOR_SAVE_FILE_ERROR:
+    case STATE_EDITOR_PROGRAM_INFO: {
         if (IsKeyPressed(KEY_SPACE) || IsKeyPressed(KEY_ENTER) || IsKeyPressed(KEY_ESCAPE)) {
             return STATE_EDITOR;
         }
@@ -285,6 +290,10 @@ void editor_error_display(State *state, char *error_message) {
     console_set_text(state, error_message);
 }
 
+void editor_info_display(State *state, char *text) {
+    console_set_text(state, text);
+}
+
 void editor_render(State *state) {
     editor_update_wrapped_line_data(state);
 
@@ -308,6 +317,7 @@ void editor_render(State *state) {
     } break;
     case STATE_EDITOR_SAVE_FILE:
     case STATE_EDITOR_SAVE_FILE_ERROR:
+    case STATE_EDITOR_PROGRAM_INFO:
     case STATE_EDITOR_FILE_EXPLORER_THEMES:
     case STATE_EDITOR_FILE_EXPLORER_PROGRAMS:
     case STATE_EDITOR_FIND_TEXT:
@@ -328,6 +338,7 @@ void editor_render(State *state) {
 void editor_free(State *state) {
     Editor *e = &state->editor;
     UnloadFont(e->font);
+    lex_cache_free(&e->lex_cache);
     if (e->clipboard.data != NULL) {
         dyn_array_release(&e->clipboard);
     }
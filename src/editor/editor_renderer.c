@@ -214,9 +214,6 @@ static void editor_render_base(State *state, float line_height, float char_width
             DrawTextCodepoint(e->font, line_number_str[j], position, line_height, state->editor.theme.linenumber);
         }
 
-        const int current_word_max_length = 32;
-        char current_word[current_word_max_length];
-
         for (int j = 0; j < line->length; j++) {
             char c = dyn_char_get(line, j);
 
@@ -255,48 +252,12 @@ static void editor_render_base(State *state, float line_height, float char_width
                     } else if (is_note_at_coord(state, coord)) {
                         color = state->editor.theme.note;
                     } else {
-                        int char_offset = 0;
-                        while (true) {
-                            if (char_offset >= current_word_max_length) {
-                                break;
-                            }
-                            if ((j + char_offset) >= line->length) {
-                                break;
-                            }
-                            if (!is_valid_in_identifier(dyn_char_get(line, j + char_offset))) {
-                                break;
-                            }
-
-                            char *c = dyn_array_get(line, j + char_offset);
-                            current_word[char_offset] = *c;
-
-                            char_offset++;
-                        }
-                        current_word[char_offset] = '\0';
-
-                        if (strcmp(current_word, "play") == 0) {
-                            color = state->editor.theme.play;
-                        } else if (strcmp(current_word, "wait") == 0) {
-                            color = state->editor.theme.wait;
-                        } else if (
-                            strcmp(current_word, "start") == 0 ||
-                            strcmp(current_word, "sine") == 0 ||
-                            strcmp(current_word, "triangle") == 0 ||
-                            strcmp(current_word, "square") == 0 ||
-                            strcmp(current_word, "sawtooth") == 0 ||
-                            strcmp(current_word, "define") == 0 ||
-                            strcmp(current_word, "repeat") == 0 ||
-                            strcmp(current_word, "rounds") == 0 ||
-                            strcmp(current_word, "forever") == 0 ||
-                            strcmp(current_word, "semi") == 0 ||
-                            strcmp(current_word, "bpm") == 0 ||
-                            strcmp(current_word, "chord") == 0 ||
-                            strcmp(current_word, "scale") == 0 ||
-                            strcmp(current_word, "rise") == 0 ||
-                            strcmp(current_word, "fall") == 0) {
-                            color = state->editor.theme.keyword;
-                        } else {
-                            color = state->editor.theme.fg;
+                        int word_length = line_word_length(line, j);
+                        switch (keyword_token_type((const char *)line->data + j, word_length)) {
+                        case TOKEN_NONE: color = state->editor.theme.fg; break;
+                        case TOKEN_PLAY: color = state->editor.theme.play; break;
+                        case TOKEN_WAIT: color = state->editor.theme.wait; break;
+                        default: color = state->editor.theme.keyword; break;
                         }
                     }
                 } else {
@@ -330,6 +291,48 @@ static void editor_render_base(State *state, float line_height, float char_width
     }
 }
 
+// underlines the word where the background check found an error and says what is wrong after the line
+static void render_check_error(State *state, float line_height, float char_width, float line_number_padding) {
+    Editor *e = &state->editor;
+    Checker_Result *result = &state->check_result;
+
+    // the result can be older than the last edit, which may have removed its line
+    if (
+        result->error_type == NO_ERROR ||
+        result->line_number >= e->lines.length ||
+        !is_line_visible(state, result->line_number)
+    ) {
+        return;
+    }
+
+    DynArray *line = dyn_array_get(&e->lines, result->line_number);
+    int char_idx = result->char_idx < line->length ? result->char_idx : line->length;
+    int length = line_word_length(line, char_idx);
+    if (length == 0) {
+        length = 1;
+    }
+
+    Editor_Coord start = editor_wrapped_coord(state, (Editor_Coord){ .y = result->line_number, .x = char_idx });
+    Vector2 underline_start = {
+        .x = line_number_padding + (start.x * char_width),
+        .y = (start.y + 1) * line_height - EDITOR_CURSOR_WIDTH,
+    };
+    Vector2 underline_end = {
+        .x = underline_start.x + (length * char_width),
+        .y = underline_start.y,
+    };
+    DrawLineEx(underline_start, underline_end, EDITOR_CURSOR_WIDTH, e->theme.console_foreground_error);
+
+    Editor_Coord summary = editor_wrapped_coord(state, (Editor_Coord){ .y = result->line_number, .x = line->length + 2 });
+    for (int i = 0; result->summary[i] != '\0'; i++) {
+        Vector2 position = {
+            line_number_padding + ((summary.x + i) * char_width),
+            summary.y * line_height
+        };
+        DrawTextCodepoint(e->font, result->summary[i], position, line_height, e->theme.console_foreground_error);
+    }
+}
+
 static void editor_render_state_write(State *state) {
     Editor *e = &state->editor;
 
@@ -380,6 +383,7 @@ static void editor_render_state_write(State *state) {
     }
 
     editor_render_base(state, line_height, char_width, line_number_padding);
+    render_check_error(state, line_height, char_width, line_number_padding);
 
     if (is_cursor_visible) {
         e->cursor_anim_time = e->cursor_anim_time + (state->delta_time * EDITOR_CURSOR_ANIMATION_SPEED);
@@ -421,7 +425,7 @@ void editor_render_state_play(State *state) {
 
     editor_render_base(state, line_height, char_width, line_number_padding);
 
-    if (state->current_sound == NULL) {
+    if (!state->is_tone_playing) {
         return;
     }
 
@@ -430,7 +434,7 @@ void editor_render_state_play(State *state) {
     float rec_line_size = 5.0f;
     Rectangle rec;
 
-    Tone *tone = &state->current_sound->tone;
+    Tone *tone = &state->current_tone;
 
     rec.x = -(rec_line_size) + line_number_padding + (tone->char_idx * char_width);
 
@@ -454,8 +458,8 @@ void editor_render_state_play(State *state) {
     Color color = e->theme.play_cursor;
 
     color.a = CLAMP(
-        ((state->current_sound->tone.duration - state->sound_time) 
-        / (float)state->current_sound->tone.duration) * 255, 
+        ((tone->duration - state->sound_time) 
+        / (float)tone->duration) * 255, 
         0, 255);
 
     DrawRectangleLinesEx(rec, 5, color);
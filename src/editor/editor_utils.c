@@ -15,6 +15,7 @@ inline static void editor_clear(State *state) {
         dyn_array_release(line);
     }
     dyn_array_clear(&e->lines);
+    lex_cache_clear(&e->lex_cache);
 
     DynArray init_line = {0};
     dyn_array_alloc(&init_line, sizeof(char));
@@ -193,6 +194,8 @@ static void add_editor_line(State *state, Editor_Coord coord) {
     }
 
     dyn_array_insert(&e->lines, coord.y + 1, &new_line, 1);
+    lex_cache_line_changed(&e->lex_cache, coord.y);
+    lex_cache_lines_inserted(&e->lex_cache, coord.y + 1, 1);
 }
 
 static void delete_editor_line(State *state, int line_idx) {
@@ -208,18 +211,22 @@ static void delete_editor_line(State *state, int line_idx) {
 
     dyn_array_release(line_to_delete);
     dyn_array_remove(&e->lines, line_idx, 1);
+    lex_cache_lines_removed(&e->lex_cache, line_idx, 1);
+    lex_cache_line_changed(&e->lex_cache, line_idx - 1);
 }
 
 static void add_editor_char(State *state, char c, Editor_Coord coord) {
     Editor *e = &state->editor;
     DynArray *line = dyn_array_get(&e->lines, coord.y);
     dyn_array_insert(line, coord.x, &c, 1);
+    lex_cache_line_changed(&e->lex_cache, coord.y);
 }
 
 static void delete_editor_char(State *state, Editor_Coord coord) {
     Editor *e = &state->editor;
     DynArray *line = dyn_array_get(&e->lines, coord.y);
     dyn_array_remove(line, coord.x, 1);
+    lex_cache_line_changed(&e->lex_cache, coord.y);
 }
 
 static Editor_Coord add_editor_string(State *state, DynArray *string, Editor_Coord coord) {
@@ -258,10 +265,12 @@ static void delete_editor_string(State *state, Editor_Coord start, Editor_Coord
             dyn_array_release(line);
         }
         dyn_array_remove(&e->lines, remove_start_idx, remove_amount);
+        lex_cache_lines_removed(&e->lex_cache, remove_start_idx, remove_amount);
     } else {
         int remove_amount = end.x - start.x;
         dyn_array_remove(start_line, start.x, remove_amount);
     }
+    lex_cache_line_changed(&e->lex_cache, start.y);
 }
 
 static void copy_editor_string(State *state, DynArray *string, Editor_Coord start, Editor_Coord end) {
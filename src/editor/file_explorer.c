@@ -63,7 +63,7 @@ bool editor_save_file(State *state) {
 
 void update_filename_buffer(State *state, char *directory) {
     Editor *e = &state->editor;
-    const char *filter = TextFormat("%s\\%s*.*", directory, e->file_search_buffer);
+    const char *filter = TextFormat("%s/%s*.*", directory, e->file_search_buffer);
     list_files(filter, e->filename_buffer, EDITOR_FILENAMES_MAX_AMOUNT);
     const char *console_text = TextFormat("%s\n%s", e->file_search_buffer, e->filename_buffer);
     console_set_text(state, console_text);
@@ -103,7 +103,7 @@ Big_State file_explorer(State *state, bool shift) {
     } else if (IsKeyPressed(KEY_ENTER)) {
         char filename[128];
         console_get_highlighted_text(state, filename);
-        const char *filepath = TextFormat("%s\\%s", directory, filename);
+        const char *filepath = TextFormat("%s/%s", directory, filename);
         switch (state->state) {
         default: return STATE_EDITOR;
         case STATE_EDITOR_FILE_EXPLORER_THEMES:
@@ -0,0 +1,319 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "main.h"
+#include "windows_wrapper.h"
+
+typedef struct Headless_Options {
+    const char *program_path;
+    const char *output_path;
+    float max_seconds;
+    int max_tones;
+    int start_line;
+    float start_seconds;
+    Audio_Format format;
+} Headless_Options;
+
+static void headless_print_usage(const char *exe) {
+    fprintf(stderr, "%s render <program> [options]\n", exe);
+    fprintf(stderr, "%s analyze <program>\n", exe);
+    fprintf(stderr, "Options:\n");
+    fprintf(stderr, "   -o <file>   write the wav to this file, \"-\" is stdout (default: <program>.wav)\n");
+    fprintf(stderr, "   -s <secs>   stop after this many seconds of audio (default: %d)\n", HEADLESS_DEFAULT_MAX_SECONDS);
+    fprintf(stderr, "   -t <tones>  stop after this many tones\n");
+    fprintf(stderr, "   -l <line>   start from this line, like a start marker there\n");
+    fprintf(stderr, "   -p <secs>   start this many seconds into the program, start markers and -l are ignored\n");
+    fprintf(stderr, "   -r <hz>     sample rate (default: %d)\n", SYNTHESIZER_DEFAULT_SAMPLE_RATE);
+    fprintf(stderr, "   -f int16|float32  sample format (default: int16)\n");
+}
+
+static bool headless_parse_options(int argc, char **argv, Headless_Options *options) {
+    *options = (Headless_Options) {
+        .program_path = NULL,
+        .output_path = NULL,
+        .max_seconds = HEADLESS_DEFAULT_MAX_SECONDS,
+        .max_tones = -1,
+        .start_line = 0,
+        .start_seconds = 0.0f,
+        .format = AUDIO_FORMAT_DEFAULT,
+    };
+    for (int i = 2; i < argc; i++) {
+        bool has_value = (i + 1) < argc;
+        if (strcmp(argv[i], "-o") == 0 && has_value) {
+            options->output_path = argv[++i];
+        } else if (strcmp(argv[i], "-s") == 0 && has_value) {
+            options->max_seconds = (float)atof(argv[++i]);
+        } else if (strcmp(argv[i], "-t") == 0 && has_value) {
+            options->max_tones = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-l") == 0 && has_value) {
+            options->start_line = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "-p") == 0 && has_value) {
+            options->start_seconds = (float)atof(argv[++i]);
+        } else if (strcmp(argv[i], "-r") == 0 && has_value) {
+            options->format.sample_rate = atoi(argv[++i]);
+            if (options->format.sample_rate < SYNTHESIZER_MIN_SAMPLE_RATE || options->format.sample_rate > SYNTHESIZER_MAX_SAMPLE_RATE) {
+                return false;
+            }
+        } else if (strcmp(argv[i], "-f") == 0 && has_value) {
+            i++;
+            if (strcmp(argv[i], "int16") == 0) {
+                options->format.sample_format = SAMPLE_FORMAT_INT16;
+            } else if (strcmp(argv[i], "float32") == 0) {
+                options->format.sample_format = SAMPLE_FORMAT_FLOAT32;
+            } else {
+                return false;
+            }
+        } else if (argv[i][0] != '-' && options->program_path == NULL) {
+            options->program_path = argv[i];
+        } else {
+            return false;
+        }
+    }
+    return options->program_path != NULL;
+}
+
+static bool headless_load_lines(const char *path, DynArray *lines) {
+    FILE *file = fopen(path, "r");
+    if (file == NULL) {
+        return false;
+    }
+    dyn_array_alloc(lines, sizeof(DynArray));
+    DynArray line;
+    dyn_array_alloc(&line, sizeof(char));
+    int c_int;
+    while ((c_int = fgetc(file)) != EOF) {
+        if (c_int == '\r') {
+            continue;
+        }
+        if (c_int == '\n') {
+            dyn_array_push(lines, &line);
+            dyn_array_alloc(&line, sizeof(char));
+        } else {
+            char c = (char)c_int;
+            dyn_array_push(&line, &c);
+        }
+    }
+    dyn_array_push(lines, &line);
+    fclose(file);
+    return true;
+}
+
+static void headless_free_lines(DynArray *lines) {
+    for (int i = 0; i < lines->length; i++) {
+        dyn_array_release(dyn_array_get(lines, i));
+    }
+    dyn_array_release(lines);
+}
+
+static void write_u32(FILE *file, uint32 value) {
+    uint8 bytes[4] = { value & 0xFF, (value >> 8) & 0xFF, (value >> 16) & 0xFF, (value >> 24) & 0xFF };
+    fwrite(bytes, 1, 4, file);
+}
+
+static void write_u16(FILE *file, uint16 value) {
+    uint8 bytes[2] = { value & 0xFF, (value >> 8) & 0xFF };
+    fwrite(bytes, 1, 2, file);
+}
+
+// a data size of 0xFFFFFFFF is what streaming writers use when the length is unknown
+static void wav_write_header(FILE *file, Audio_Format format, uint32 data_size) {
+    const int sample_bytes = mix_sample_bytes(format.sample_format);
+    const int block_align = SYNTHESIZER_CHANNELS * sample_bytes;
+    fwrite("RIFF", 1, 4, file);
+    write_u32(file, data_size == 0xFFFFFFFF ? data_size : data_size + 36);
+    fwrite("WAVE", 1, 4, file);
+    fwrite("fmt ", 1, 4, file);
+    write_u32(file, 16);
+    write_u16(file, format.sample_format == SAMPLE_FORMAT_FLOAT32 ? 3 : 1); // IEEE float or PCM
+    write_u16(file, SYNTHESIZER_CHANNELS);
+    write_u32(file, format.sample_rate);
+    write_u32(file, format.sample_rate * block_align);
+    write_u16(file, block_align);
+    write_u16(file, sample_bytes * 8);
+    fwrite("data", 1, 4, file);
+    write_u32(file, data_size);
+}
+
+// takes the first frame_count frames of the sound a block at a time like the audio callback does, which
+// generates the sounds too long to be rendered ahead. Interleaved and written to output, unless that is NULL
+static void headless_play_sound(Synthesizer *synthesizer, Synthesizer_Sound *sound, int frame_count, FILE *output) {
+    Sample_Format format = synthesizer->format.sample_format;
+    float block[SYNTHESIZER_BLOCK_FRAMES];
+    // room for either format
+    float buffer[SYNTHESIZER_BLOCK_FRAMES * SYNTHESIZER_CHANNELS];
+    for (int first_frame = 0; first_frame < frame_count; first_frame += SYNTHESIZER_BLOCK_FRAMES) {
+        int block_frames = frame_count - first_frame;
+        if (block_frames > SYNTHESIZER_BLOCK_FRAMES) {
+            block_frames = SYNTHESIZER_BLOCK_FRAMES;
+        }
+        const float *samples = synthesizer_sound_frames(synthesizer, sound, first_frame, block_frames, block);
+        if (output != NULL) {
+            mix_fan_out(samples, block_frames, format, buffer);
+            fwrite(buffer, mix_sample_bytes(format), block_frames * SYNTHESIZER_CHANNELS, output);
+        }
+    }
+}
+
+typedef struct Headless_Result {
+    long long frame_count;
+    int tone_count;
+    bool limit_reached;
+} Headless_Result;
+
+// renders a started compiler until the program ends or a limit is reached, output may be NULL.
+// The tone that reaches max_frames is cut off there, a negative max_tones is no limit
+static Headless_Result headless_render(Synthesizer *synthesizer, Compiler *compiler, long long max_frames, int max_tones, FILE *output) {
+    Headless_Result result = {0};
+    result.limit_reached = max_frames <= 0 || max_tones == 0;
+    while (!result.limit_reached) {
+        Synthesizer_Sound sounds[SYNTHESIZER_TONE_CAPACITY];
+        synthesizer_render_tones(synthesizer, compiler->tones, compiler->tone_amount, sounds);
+        for (int i = 0; i < compiler->tone_amount; i++) {
+            if (!result.limit_reached) {
+                long long frames_left = max_frames - result.frame_count;
+                int frame_count = sounds[i].frame_count < frames_left ? sounds[i].frame_count : (int)frames_left;
+                headless_play_sound(synthesizer, &sounds[i], frame_count, output);
+                result.frame_count += frame_count;
+                result.tone_count++;
+                result.limit_reached = result.frame_count >= max_frames || result.tone_count == max_tones;
+            }
+            synthesizer_sound_release(synthesizer, &sounds[i]);
+        }
+        if (result.limit_reached || !has_flag(compiler->flags, COMPILER_FLAG_IN_PROCESS)) {
+            break;
+        }
+        compiler_continue(compiler);
+        if (compiler->tone_amount == 0) {
+            break;
+        }
+    }
+    return result;
+}
+
+// prints the length, tone count and lookahead of a program without rendering it
+static int headless_analyze(const char *program_path, DynArray *lines) {
+    Compiler *compiler = (Compiler *)dyn_mem_alloc_zero(sizeof(Compiler));
+    compiler_init(compiler);
+
+    Analysis analysis;
+    bool is_compiled = compiler_analyze(compiler, lines, &analysis);
+    if (is_compiled) {
+        char text[CONSOLE_LINE_MAX_LENGTH * 4];
+        analysis_format(&analysis, text, sizeof(text));
+        printf("%s:\n%s\n", program_path, text);
+    } else {
+        fprintf(stderr, "%s\n", compiler->error_message);
+    }
+
+    compiler_free(compiler);
+    dyn_mem_release(compiler);
+    headless_free_lines(lines);
+    return is_compiled ? 0 : 1;
+}
+
+int headless_run(int argc, char **argv) {
+    Headless_Options options;
+    if (!headless_parse_options(argc, argv, &options)) {
+        headless_print_usage(argv[0]);
+        return 1;
+    }
+
+    DynArray lines;
+    if (!headless_load_lines(options.program_path, &lines)) {
+        fprintf(stderr, "Could not open \"%s\"\n", options.program_path);
+        return 1;
+    }
+
+    if (strcmp(argv[1], "analyze") == 0) {
+        return headless_analyze(options.program_path, &lines);
+    }
+
+    bool to_stdout = options.output_path != NULL && strcmp(options.output_path, "-") == 0;
+    char default_output_path[EDITOR_FILENAME_MAX_LENGTH + 8];
+    if (options.output_path == NULL) {
+        int length = snprintf(default_output_path, sizeof(default_output_path), "%s.wav", options.program_path);
+        if (length < 0 || length >= (int)sizeof(default_output_path)) {
+            fprintf(stderr, "The path \"%s\" is too long to add .wav to, give the output file with -o\n", options.program_path);
+            headless_free_lines(&lines);
+            return 1;
+        }
+        options.output_path = default_output_path;
+    }
+
+    Compiler *compiler = (Compiler *)dyn_mem_alloc_zero(sizeof(Compiler));
+    Synthesizer synthesizer = {0};
+    compiler_init(compiler);
+    synthesizer_init_offline(&synthesizer, options.format);
+
+    if (options.start_seconds > 0.0f) {
+        compiler_start_at_seconds(compiler, &lines, options.start_seconds);
+    } else {
+        compiler_start_from(compiler, &lines, options.start_line - 1, 0);
+    }
+    if (compiler->error_type != NO_ERROR) {
+        fprintf(stderr, "%s\n", compiler->error_message);
+        synthesizer_free_offline(&synthesizer);
+        compiler_free(compiler);
+        dyn_mem_release(compiler);
+        headless_free_lines(&lines);
+        return 1;
+    }
+
+    FILE *output;
+    if (to_stdout) {
+        set_stdout_binary();
+        output = stdout;
+    } else {
+        output = fopen(options.output_path, "wb");
+        if (output == NULL) {
+            fprintf(stderr, "Could not write \"%s\"\n", options.output_path);
+            synthesizer_free_offline(&synthesizer);
+            compiler_free(compiler);
+            dyn_mem_release(compiler);
+            headless_free_lines(&lines);
+            return 1;
+        }
+    }
+    wav_write_header(output, options.format, to_stdout ? 0xFFFFFFFF : 0);
+
+    double start_time = get_time_seconds();
+    long long max_frames = (long long)(options.max_seconds * options.format.sample_rate);
+    Headless_Result result = headless_render(&synthesizer, compiler, max_frames, options.max_tones, output);
+    double render_time = get_time_seconds() - start_time;
+
+    if (!to_stdout) {
+        fseek(output, 0, SEEK_SET);
+        long long frame_bytes = SYNTHESIZER_CHANNELS * mix_sample_bytes(options.format.sample_format);
+        wav_write_header(output, options.format, (uint32)(result.frame_count * frame_bytes));
+        fclose(output);
+    } else {
+        fflush(output);
+    }
+
+    float audio_seconds = (float)result.frame_count / (float)options.format.sample_rate;
+    fprintf(
+        stderr,
+        "%s: %d tones, %.2fs of audio rendered in %.3fs (%.1fx real time)%s\n",
+        options.program_path,
+        result.tone_count,
+        audio_seconds,
+        render_time,
+        render_time > 0.0 ? audio_seconds / render_time : 0.0,
+        result.limit_reached ? ", stopped at limit" : ""
+    );
+    Tone_Cache *cache = &synthesizer.tone_cache;
+    fprintf(
+        stderr,
+        "tone cache: %lld hits, %lld misses (%.1f%% hit rate), %lld evictions\n",
+        cache->hits,
+        cache->misses,
+        tone_cache_hit_rate(cache) * 100.0f,
+        cache->evictions
+    );
+
+    synthesizer_free_offline(&synthesizer);
+    compiler_free(compiler);
+    dyn_mem_release(compiler);
+    headless_free_lines(&lines);
+    return 0;
+}
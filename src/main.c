@@ -1,13 +1,19 @@
 #include "main.h"
 
 #include "compiler/compiler.c"
+#include "checker.c"
 #include "editor/editor.c"
 #include "synthesizer.c"
+#include "headless.c"
 
 #ifdef TEST
     #include "test.c"
 #endif
 
+#ifdef BENCHMARK
+    #include "benchmark.c"
+#endif
+
 #define OCTAVE_OFFSET 12.0f
 #define MAX_OCTAVE 8
 #define A4_OFFSET 48
@@ -19,22 +25,42 @@
 void compiler_thread(void *data) {
     State *state = (State *)data;
     do {
-        while (!compiler_can_continue(&state->compiler)) {
-            if (has_flag(state->compiler.flags, COMPILER_FLAG_CANCELLED)) {
-                return;
-            }
+        if (compiler_is_cancelled(&state->compiler)) {
+            return;
         }
         compiler_continue(&state->compiler);
-        synthesizer_back_buffer_generate_data(&state->synthesizer, &state->compiler);
+        // blocks while the ring is full, until the synthesizer has room or is cancelled
+        synthesizer_queue_tones(&state->synthesizer, &state->compiler);
     } while (has_flag(state->compiler.flags, COMPILER_FLAG_IN_PROCESS));
 }
 
+// the compiler thread has to be gone before the compiler and the synthesizer are reset under it
+static void stop_playback(State *state) {
+    synthesizer_cancel(&state->synthesizer);
+    compiler_cancel(&state->compiler);
+    if (state->compiler.thread != NULL) {
+        thread_join(state->compiler.thread);
+        state->compiler.thread = NULL;
+    }
+    synthesizer_reset(&state->synthesizer);
+    compiler_reset(&state->compiler);
+    state->is_tone_playing = false;
+}
+
 int main(int argc, char **argv) {
     #ifdef TEST
         run_tests();
         exit(0);
     #endif
 
+    #ifdef BENCHMARK
+        return benchmark_run(argc, argv);
+    #endif
+
+    if (argc > 1 && (strcmp(argv[1], "render") == 0 || strcmp(argv[1], "analyze") == 0)) {
+        return headless_run(argc, argv);
+    }
+
     State *state = (State *)dyn_mem_alloc_zero(sizeof(State));
 
     SetTraceLogLevel(
@@ -61,7 +87,9 @@ int main(int argc, char **argv) {
     editor_init(state, filename);
 
     compiler_init(&state->compiler);
-    synthesizer_init(&state->synthesizer);
+    state->compiler.lex_cache = &state->editor.lex_cache;
+    checker_init(&state->checker);
+    synthesizer_init(&state->synthesizer, AUDIO_FORMAT_DEFAULT, SYNTHESIZER_RING_DEFAULT_DEPTH);
 
     bool is_playing = false;
 
@@ -72,17 +100,22 @@ int main(int argc, char **argv) {
 
         switch (state->state) {
         default: break;
-        case STATE_TRY_COMPILE: {
-            compiler_start(&state->compiler, &state->editor.lines);
+        case STATE_TRY_COMPILE:
+        case STATE_TRY_COMPILE_FROM_CURSOR: {
+            if (state->state == STATE_TRY_COMPILE_FROM_CURSOR) {
+                Editor_Coord cursor = state->editor.cursor;
+                compiler_start_from(&state->compiler, &state->editor.lines, cursor.y, cursor.x);
+            } else {
+                compiler_start(&state->compiler, &state->editor.lines);
+            }
             if (state->compiler.error_type != NO_ERROR) {
                 editor_error_display(state, state->compiler.error_message);
                 compiler_reset(&state->compiler);
                 state->state = STATE_COMPILATION_ERROR;
                 continue;
             }
-            synthesizer_back_buffer_generate_data(&state->synthesizer, &state->compiler);
-            synthesizer_swap_sound_buffers(&state->synthesizer);
-            compiler_output_handled(&state->compiler);
+            synthesizer_queue_tones(&state->synthesizer, &state->compiler);
+            synthesizer_play(&state->synthesizer);
 
             if (has_flag(state->compiler.flags, COMPILER_FLAG_IN_PROCESS)) {
                 state->compiler.thread = thread_create(compiler_thread, state);
@@ -94,31 +127,35 @@ int main(int argc, char **argv) {
             is_playing = true;
             state->state = STATE_WAITING_TO_PLAY;
         } break;
+        case STATE_TRY_ANALYZE: {
+            Analysis analysis;
+            if (compiler_analyze(&state->compiler, &state->editor.lines, &analysis)) {
+                char text[CONSOLE_LINE_MAX_LENGTH * 4];
+                analysis_format(&analysis, text, sizeof(text));
+                editor_info_display(state, text);
+                state->state = STATE_EDITOR_PROGRAM_INFO;
+            } else {
+                editor_error_display(state, state->compiler.error_message);
+                state->state = STATE_COMPILATION_ERROR;
+            }
+            compiler_reset(&state->compiler);
+        } break;
         case STATE_WAITING_TO_PLAY: {
-            if (state->current_sound != NULL) {
+            if (state->is_tone_playing) {
                 state->state = STATE_PLAY;
-                state->sound_time = 0;
                 break;
             }
         } break;
         case STATE_PLAY: {
-            if (state->current_sound == NULL) {
-                compiler_output_handled(&state->compiler);
-                bool synthesizer_has_more_sounds = synthesizer_swap_sound_buffers(&state->synthesizer);
-                if (!synthesizer_has_more_sounds) {
-                    state->state = STATE_EDITOR;
-                    synthesizer_reset(&state->synthesizer);
-                    compiler_reset(&state->compiler);
-                    is_playing = false;
-                }
+            if (!synthesizer_is_playing(&state->synthesizer)) {
+                state->state = STATE_EDITOR;
+                stop_playback(state);
+                is_playing = false;
             }
-            state->sound_time += state->delta_time;
         } break;
         case STATE_INTERRUPT: {
             if (is_playing) {
-                synthesizer_reset(&state->synthesizer);
-                compiler_reset(&state->compiler);
-                state->current_sound = NULL;
+                stop_playback(state);
                 is_playing = false;
             }
             state->state = STATE_EDITOR;
@@ -128,12 +165,15 @@ int main(int argc, char **argv) {
         } break;
         }
 
-        if (is_playing && !is_synthesizer_sound_playing(state->current_sound)) {
-            state->sound_time = 0;
-            state->current_sound = synthesizer_front_buffer_try_get_sound(&state->synthesizer);
-            if (state->current_sound != NULL) {
-                PlaySound(state->current_sound->sound);
-            }
+        checker_update(&state->checker, &state->editor.lines, state->editor.lex_cache.revision, state->delta_time);
+        checker_poll(&state->checker, &state->check_result);
+
+        if (is_playing) {
+            state->is_tone_playing = synthesizer_get_current_tone(
+                &state->synthesizer,
+                &state->current_tone,
+                &state->sound_time
+            );
         }
 
         BeginDrawing();
@@ -144,6 +184,12 @@ int main(int argc, char **argv) {
 
     application_exit:
 
+    if (is_playing) {
+        stop_playback(state);
+    }
+    synthesizer_free(&state->synthesizer);
+    checker_free(&state->checker);
+
     CloseWindow();
     CloseAudioDevice();
 
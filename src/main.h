@@ -16,6 +16,7 @@ typedef short int16;
 typedef short unsigned uint16;
 typedef char int8;
 typedef char unsigned uint8;
+typedef unsigned int uint32;
 
 #ifdef DEBUG
     __attribute__((unused))
@@ -89,6 +90,7 @@ typedef char unsigned uint8;
 #define MAX_NOTE 50
 #define MIN_NOTE -44
 #define SILENCE (MAX_NOTE + 1)
+#define SCALE_MASK_COUNT (1 << OCTAVE)
 #define COMMENT_CHAR '!'
 
 #define EDITOR_LINE_NUMBER_PADDING 5
@@ -113,13 +115,56 @@ typedef char unsigned uint8;
 #define CONSOLE_LINE_CAPACITY 32
 #define CONSOLE_LINE_MAX_LENGTH 255
 
-#define VARIABLE_MAX_COUNT 255
-
-#define SYNTHESIZER_FADE_FRAMES 500
+#define SYMBOL_TABLE_INITIAL_CAPACITY 64
+#define COMPILER_ARENA_CHUNK_SIZE (1 << 20)
+#define TOKEN_INITIAL_CAPACITY 4096
+#define PARSER_SEEK_MAX_TONES (1 << 24)
+#define PARSER_CHECKPOINT_INTERVAL_SECONDS 4.0
+#define ANALYZER_MAX_STEPS (1 << 24)
+#define ANALYZER_MAX_CALL_DEPTH (1 << 16)
+#define CHECKER_DEBOUNCE_SECONDS 0.25f
+
+// the 500 frames tones always faded over at 44.1 kHz
+#define SYNTHESIZER_FADE_SECONDS (500.0f / 44100.0f)
 #define SYNTHESIZER_TONE_CAPACITY 8
+#define SYNTHESIZER_RING_DEFAULT_DEPTH 32
+#define SYNTHESIZER_DEFAULT_SAMPLE_RATE 44100
+#define SYNTHESIZER_MIN_SAMPLE_RATE 8000
+#define SYNTHESIZER_MAX_SAMPLE_RATE 192000
+#define SYNTHESIZER_CHANNELS 2
+#define SYNTHESIZER_STREAM_BUFFER_FRAMES 1024
+// how often the feeder looks at what the audio callback has played, well under the 23 ms the stream buffer lasts
+#define SYNTHESIZER_FEED_MILLISECONDS 2
+// tones longer than this are not rendered ahead, they are generated a block at a time while they play
+#define SYNTHESIZER_BLOCK_FRAMES 1024
+#define SYNTHESIZER_MAX_RENDERED_FRAMES (SYNTHESIZER_BLOCK_FRAMES * 64)
+// how many blocks of such a tone the feeder keeps ready ahead of the audio callback
+#define SYNTHESIZER_AHEAD_BLOCKS 8
+
+#define HEADLESS_DEFAULT_MAX_SECONDS 600
+#define BENCHMARK_MAX_PROGRAMS 64
+
+#define RENDER_POOL_MAX_WORKERS 16
+
+#define TONE_CACHE_BUCKETS 1024
+#define TONE_CACHE_DEFAULT_MAX_ENTRIES 512
+#define TONE_CACHE_DEFAULT_MAX_BYTES (64 * 1024 * 1024)
+
+// 4 size classes per octave from 4 KiB up to 1.75 GiB
+#define PCM_POOL_MIN_BLOCK_BYTES 4096
+#define PCM_POOL_CLASS_COUNT (19 * 4)
+#define PCM_POOL_DEFAULT_MAX_FREE_BYTES (32 * 1024 * 1024)
+
+#define OSCILLATOR_TABLE_BITS 11
+#define OSCILLATOR_TABLE_SIZE (1 << OSCILLATOR_TABLE_BITS)
+
+#ifdef BENCHMARK
+    #define DYN_MEM_TRACK_BYTES
+#endif
 
 #include "dynamic_memory.c"
 #include "dynamic_array.c"
+#include "arena.c"
 
 typedef enum Waveform {
     WAVEFORM_NONE,
@@ -127,14 +172,56 @@ typedef enum Waveform {
     WAVEFORM_TRIANGLE,
     WAVEFORM_SQUARE,
     WAVEFORM_SAWTOOTH,
+    WAVEFORM_COUNT,
 } Waveform;
 
+typedef enum Oscillator_Mode {
+    OSCILLATOR_MODE_WAVETABLE,
+    OSCILLATOR_MODE_FORMULA,
+} Oscillator_Mode;
+
+typedef struct Oscillator {
+    uint32 phase;
+    uint32 phase_increment;
+} Oscillator;
+
+// frames [first_frame, first_frame + frame_count) of a tone that lasts tone_frame_count frames,
+// the envelope is the one of the whole tone
+typedef struct Mix_Range {
+    int first_frame;
+    int frame_count;
+    int tone_frame_count;
+    int fade_frames;
+} Mix_Range;
+
+typedef void (*Mix_Kernel)(const float *table, Oscillator *oscillators, int voice_count, Mix_Range range, float *samples);
+
+// what samples are sent to the device or written to a wav as, tones are always rendered in float
+typedef enum Sample_Format {
+    SAMPLE_FORMAT_INT16,
+    SAMPLE_FORMAT_FLOAT32,
+} Sample_Format;
+
+typedef struct Audio_Format {
+    int sample_rate;
+    Sample_Format sample_format;
+} Audio_Format;
+
+#define AUDIO_FORMAT_DEFAULT ((Audio_Format){ SYNTHESIZER_DEFAULT_SAMPLE_RATE, SAMPLE_FORMAT_INT16 })
+
 typedef struct Chord {
     uint8 size;
     int8 notes[OCTAVE];
     float frequencies[OCTAVE];
 } Chord;
 
+// semitones from each pitch class to the next degree of a scale, up and down
+typedef struct Scale_Steps {
+    int8 up[OCTAVE];
+    int8 down[OCTAVE];
+    int8 degree_count;
+} Scale_Steps;
+
 typedef struct Tone {
     Waveform waveform;
     int token_idx;
@@ -204,6 +291,15 @@ typedef struct Editor_Wrap_Line {
     int wrap_amount;
 } Editor_Wrap_Line;
 
+// the tokens of every editor line as the lexer left them, kept in step with the lines by the editor
+typedef struct Lex_Cache {
+    struct Lex_Line *lines;
+    int line_count;
+    int line_capacity;
+    // counts the changes reported, the background check looks again when it moved
+    uint32 revision;
+} Lex_Cache;
+
 typedef struct Editor {
     Font font;
 
@@ -255,6 +351,8 @@ typedef struct Editor {
     int console_highlight_idx;
 
     DynArray whatever_buffer;
+
+    Lex_Cache lex_cache;
 } Editor;
 
 typedef struct Editor_Selection_Data {
@@ -314,7 +412,15 @@ typedef union Token_Value {
         float duration;
         int char_count;
     } play_or_wait;
-    char *string;
+    struct {
+        int symbol_id;
+        int define_address;
+    } identifier;
+    // what an identifier holds between being lexed and being interned
+    struct {
+        uint32 hash;
+        int length;
+    } name;
 } Token_Value;
 
 typedef struct Token {
@@ -325,10 +431,23 @@ typedef struct Token {
     Token_Value value;
 } Token;
 
-typedef struct Token_Variable {
-    char *ident;
-    int address;
-} Token_Variable;
+typedef struct Symbol {
+    char *name;
+    int length;
+    uint32 hash;
+    int define_address;
+    int code_address;
+} Symbol;
+
+typedef struct Symbol_Table {
+    Symbol *symbols;
+    int symbol_count;
+    int symbol_capacity;
+    int *slots;
+    int slot_capacity;
+    // holds the names as well as both arrays
+    Arena *arena;
+} Symbol_Table;
 
 typedef struct Repetition {
     int target;
@@ -339,8 +458,6 @@ typedef enum Compiler_Flags {
     COMPILER_FLAG_NONE = 0,
     COMPILER_FLAG_CANCELLED = 1 << 0,
     COMPILER_FLAG_IN_PROCESS = 1 << 1,
-    COMPILER_FLAG_OUTPUT_AVAILABLE = 1 << 2,
-    COMPILER_FLAG_OUTPUT_HANDLED = 1 << 3,
 } Compiler_Flags;
 
 typedef enum Compiler_Error {
@@ -357,7 +474,6 @@ typedef enum Compiler_Error {
     ERROR_EXPECTED_NUMBER,
     ERROR_NUMBER_TOO_BIG,
     ERROR_NO_MATCHING_OPENING_PAREN,
-    ERROR_NESTING_TOO_DEEP,
     ERROR_CHORD_CAN_ONLY_CONTAIN_NOTES,
     ERROR_CHORD_CAN_NOT_BE_EMPTY,
     ERROR_CHORD_TOO_MANY_NOTES,
@@ -370,18 +486,150 @@ typedef struct Compiler_Error_Address {
     int token_idx;
 } Compiler_Error_Address;
 
+// a line's tokens before their parens are linked and identifiers interned,
+// with the error that stopped lexing the line if there was one
+typedef struct Lex_Line {
+    Token *tokens;
+    int token_count;
+    int token_capacity;
+    Compiler_Error error;
+    int error_char_idx;
+    bool is_dirty;
+} Lex_Line;
+
+typedef enum Opcode {
+    OP_HALT = 0,
+    OP_EMIT_TONE,
+    OP_START,
+    OP_SET_WAVEFORM,
+    OP_SET_BPM,
+    OP_SET_NOTE,
+    OP_SET_CHORD,
+    OP_SET_SCALE,
+    OP_TRANSPOSE,
+    OP_LOOP,
+    OP_END_LOOP,
+    OP_ROUNDS,
+    OP_JUMP,
+    OP_CALL,
+    OP_RET,
+} Opcode;
+
+typedef struct Instruction {
+    uint8 opcode;
+    union {
+        int number;
+        int target;
+        struct {
+            float duration;
+            uint16 line_idx;
+            uint16 char_idx;
+            uint16 char_count;
+            bool is_play;
+        } tone;
+        struct {
+            int steps;
+            int8 direction;
+            bool is_chromatic;
+        } transpose;
+        struct {
+            int first;
+            int count;
+            int end;
+        } rounds;
+    } as;
+} Instruction;
+
+typedef struct Bytecode {
+    Instruction *instructions;
+    int instruction_count;
+    int instruction_capacity;
+    Chord *chords;
+    int chord_count;
+    int chord_capacity;
+    int *round_numbers;
+    int round_number_count;
+    int round_number_capacity;
+    bool has_start;
+} Bytecode;
+
 typedef struct Parser {
-    int token_idx;
-    int nest_idx;
-    Repetition nest_repetitions[16];
+    int pc;
+    Repetition *loops;
+    int loop_count;
+    int loop_capacity;
+    int *returns;
+    int return_count;
+    int return_capacity;
     int current_bpm;
     Waveform current_waveform;
-    int token_ptr_return_positions[32];
-    int token_ptr_return_idx;
     Chord current_chord;
     int current_scale;
+    bool is_seeking;
+    int seek_skipped_tones;
+    // the pc and stacks at a jump back while seeking the start marker, see parser_seek_repeats
+    int *seek_snapshot;
+    int seek_snapshot_length;
+    int seek_snapshot_capacity;
+    int seek_jump_count;
+    // seeking to a time ends at the first tone starting there, a negative time seeks to the start marker
+    double seek_until_seconds;
+    // musical time from the beginning of the program, skipped tones included
+    double elapsed_seconds;
 } Parser;
 
+// the parser state right before a tone, its stacks are slices of the shared pools
+typedef struct Parser_Checkpoint {
+    double elapsed_seconds;
+    int pc;
+    int loop_first;
+    int loop_count;
+    int return_first;
+    int return_count;
+    int current_bpm;
+    Waveform current_waveform;
+    Chord current_chord;
+    int current_scale;
+} Parser_Checkpoint;
+
+typedef struct Parser_Checkpoints {
+    Parser_Checkpoint *items;
+    int count;
+    int capacity;
+    Repetition *loops;
+    int loop_count;
+    int loop_capacity;
+    int *returns;
+    int return_count;
+    int return_capacity;
+    // runs ahead of playback and only ever as far as the furthest seek so far
+    Parser recorder;
+    bool is_recording;
+    bool is_complete;
+} Parser_Checkpoints;
+
+typedef enum Analysis_Length {
+    ANALYSIS_LENGTH_FINITE,
+    // ends in a period that repeats forever
+    ANALYSIS_LENGTH_FOREVER,
+    // still changing after ANALYZER_MAX_STEPS or ANALYZER_MAX_CALL_DEPTH, like a recursion without end
+    ANALYSIS_LENGTH_UNKNOWN,
+} Analysis_Length;
+
+// what a program plays, worked out from the bytecode without rendering it. For a program that
+// repeats forever the counts cover what comes before the repetition, the period covers one round of it.
+// Frames are counted at SYNTHESIZER_DEFAULT_SAMPLE_RATE
+typedef struct Analysis {
+    Analysis_Length length;
+    long long tone_count;
+    long long frame_count;
+    long long period_tone_count;
+    long long period_frame_count;
+    int max_chord_size;
+    // the most bytes of PCM queued when SYNTHESIZER_RING_DEFAULT_DEPTH tones are rendered ahead
+    long long peak_lookahead_bytes;
+} Analysis;
+
 typedef struct Compiler {
     Compiler_Flags flags;
     Compiler_Error error_type;
@@ -391,41 +639,172 @@ typedef struct Compiler {
     int line_number;
     int char_idx;
     int token_amount;
+    int token_capacity;
     Token *tokens;
+    // tokens, symbols and bytecode live here until the next compile or reset
+    Arena arena;
     int tone_amount;
     Tone tones[SYNTHESIZER_TONE_CAPACITY];
-    Token_Variable variables[VARIABLE_MAX_COUNT];
-    int variable_count;
+    Symbol_Table symbols;
+    Bytecode bytecode;
+    Parser_Checkpoints checkpoints;
+    // lines that did not change since the last compile are not lexed again, NULL lexes everything
+    Lex_Cache *lex_cache;
+    int start_line_number;
+    int start_char_idx;
     Thread thread;
     Mutex mutex;
     int extra_compiler_entry_token_idx;
 } Compiler;
 
+typedef struct Checker_Result {
+    uint32 revision;
+    Compiler_Error error_type;
+    int line_number;
+    int char_idx;
+    // the error message without the line and the excerpt, on one line
+    char summary[128];
+} Checker_Result;
+
+// validates the editor's lines on a thread of its own while they are edited. The frame loop
+// hands over a copy once the lines stopped changing for CHECKER_DEBOUNCE_SECONDS and never
+// waits for a check, a check whose lines were replaced in the meantime is not published
+typedef struct Checker {
+    Thread thread;
+    Mutex mutex;
+    Event work_available;
+    // only the checker thread touches these
+    Compiler compiler;
+    Lex_Cache lex_cache;
+    DynArray lines;
+    // handed over under the mutex
+    DynArray snapshot;
+    uint32 snapshot_revision;
+    bool has_snapshot;
+    Checker_Result result;
+    bool has_result;
+    bool should_quit;
+    // only the frame loop touches these
+    uint32 seen_revision;
+    uint32 submitted_revision;
+    float idle_seconds;
+} Checker;
+
+typedef struct Render_Job {
+    struct Synthesizer *synthesizer;
+    Tone *tone;
+    float *samples;
+    int frame_count;
+} Render_Job;
+
+typedef struct Render_Pool {
+    void (*render)(Render_Job *job);
+    Thread workers[RENDER_POOL_MAX_WORKERS];
+    int worker_count;
+    Mutex mutex;
+    Semaphore work_available;
+    Semaphore batch_done;
+    Render_Job *jobs;
+    int job_count;
+    int next_job;
+    int finished_jobs;
+    bool is_caller_waiting;
+    bool should_quit;
+} Render_Pool;
+
+typedef struct Tone_Cache_Key {
+    Oscillator_Mode oscillator_mode;
+    Waveform waveform;
+    int chord_size;
+    float frequencies[OCTAVE];
+    int frame_count;
+    int sample_rate;
+} Tone_Cache_Key;
+
+typedef struct Tone_Cache_Entry {
+    Tone_Cache_Key key;
+    uint32 hash;
+    int ref_count;
+    int byte_count;
+    float *samples;
+    struct Tone_Cache_Entry *bucket_next;
+    struct Tone_Cache_Entry *lru_prev;
+    struct Tone_Cache_Entry *lru_next;
+} Tone_Cache_Entry;
+
+// rendered tones come and go at the pace of the music, the blocks of the ones
+// that were played are kept for the next ones instead of going back to the heap
+typedef struct Pcm_Pool {
+    void *free_lists[PCM_POOL_CLASS_COUNT];
+    long long free_bytes;
+    long long max_free_bytes;
+    long long reuses;
+} Pcm_Pool;
+
+typedef struct Tone_Cache {
+    Mutex mutex;
+    Pcm_Pool pool;
+    Tone_Cache_Entry *buckets[TONE_CACHE_BUCKETS];
+    Tone_Cache_Entry *lru_head;
+    Tone_Cache_Entry *lru_tail;
+    int entry_count;
+    int byte_count;
+    int max_entries;
+    int max_bytes;
+    long long hits;
+    long long misses;
+    long long evictions;
+} Tone_Cache;
+
+// mono, channels are only made when the samples are sent to the device
 typedef struct Synthesizer_Sound {
-    int16 *raw_data;
+    Tone_Cache_Entry *cache_entry;
+    float *samples;
+    int frame_count;
     Tone tone;
-    Sound sound;
+    // a tone too long to be rendered has no samples. When played live its blocks are rendered
+    // ahead into a ring of SYNTHESIZER_AHEAD_BLOCKS, frames [played_frames, generated_frames) are ready
+    float *blocks;
+    int generated_frames;
+    int played_frames;
 } Synthesizer_Sound;
 
 typedef enum Synthesizer_Flags {
     SYNTHESIZER_FLAG_NONE = 0,
     SYNTHESIZER_FLAG_SHOULD_CANCEL = 1 << 0,
-    SYNTHESIZER_FLAG_SOUND_BUFFER_SWAP_REQUIRED = 1 << 1,
-    SYNTHESIZER_FLAG_COMPLETED = 1 << 2,
+    SYNTHESIZER_FLAG_COMPLETED = 1 << 1,
+    SYNTHESIZER_FLAG_PLAYING = 1 << 2,
+    SYNTHESIZER_FLAG_QUIT = 1 << 3,
 } Synthesizer_Flags;
 
-typedef struct Sound_Buffer {
-    Synthesizer_Sound sounds[SYNTHESIZER_TONE_CAPACITY];
-    int sound_count;
-    Mutex mutex;
-} Sound_Buffer;
+// single producer (the compiler thread) and single consumer (the audio callback),
+// indices only ever grow and are masked with capacity - 1
+typedef struct Tone_Ring {
+    Synthesizer_Sound *slots;
+    uint32 capacity;
+    uint32 head;
+    uint32 tail;
+    uint32 reclaimed;
+} Tone_Ring;
 
 typedef struct Synthesizer {
     Synthesizer_Flags flags;
-    int current_sound_idx;
-    Sound_Buffer buffers[2];
-    Sound_Buffer *front_buffer;
-    Sound_Buffer *back_buffer;
+    Audio_Format format;
+    Oscillator_Mode oscillator_mode;
+    Mix_Kernel mix_kernel;
+    // live the feeder renders long tones ahead, offline they are generated when they are taken
+    bool generates_ahead;
+    Render_Pool render_pool;
+    Tone_Cache tone_cache;
+    AudioStream stream;
+    Mutex mutex;
+    // the audio callback never signals anything, the feeder thread notices what it played
+    Thread feeder;
+    Event feeder_event;
+    Event space_available_event;
+    Tone_Ring ring;
+    int current_frame;
+    int active_callbacks;
 } Synthesizer;
 
 typedef enum Big_State {
@@ -433,11 +812,14 @@ typedef enum Big_State {
     STATE_EDITOR_THEME_ERROR,
     STATE_EDITOR_SAVE_FILE,
     STATE_EDITOR_SAVE_FILE_ERROR,
+    STATE_EDITOR_PROGRAM_INFO,
     STATE_EDITOR_FILE_EXPLORER_THEMES,
     STATE_EDITOR_FILE_EXPLORER_PROGRAMS,
     STATE_EDITOR_FIND_TEXT,
     STATE_EDITOR_GO_TO_LINE,
     STATE_TRY_COMPILE,
+    STATE_TRY_COMPILE_FROM_CURSOR,
+    STATE_TRY_ANALYZE,
     STATE_COMPILATION_ERROR,
     STATE_WAITING_TO_PLAY,
     STATE_PLAY,
@@ -451,8 +833,11 @@ typedef struct State {
     float delta_time;
     Editor editor;
     Compiler compiler;
+    Checker checker;
+    Checker_Result check_result;
     Synthesizer synthesizer;
-    Synthesizer_Sound *current_sound;
+    bool is_tone_playing;
+    Tone current_tone;
     float sound_time;
 } State;
 
@@ -0,0 +1,187 @@
+#ifndef MIX_KERNEL_C
+#define MIX_KERNEL_C
+
+#include "main.h"
+#include "oscillator.c"
+
+#if defined(__x86_64__) || defined(__i386__)
+    #define MIX_KERNEL_X86
+    #include <immintrin.h>
+#endif
+
+// the fades last as long at every sample rate
+inline static int mix_fade_frames(int sample_rate) {
+    return (int)(SYNTHESIZER_FADE_SECONDS * (float)sample_rate + 0.5f);
+}
+
+inline static float mix_envelope(int frame, int frame_count, int fade_frames) {
+    if (frame < fade_frames) {
+        // Fade-in
+        return (float)frame / (float)fade_frames;
+    }
+    if (frame >= frame_count - fade_frames) {
+        // Fade-out
+        return (float)(frame_count - frame) / (float)fade_frames;
+    }
+    return 1.0f;
+}
+
+inline static int mix_sample_bytes(Sample_Format format) {
+    return format == SAMPLE_FORMAT_FLOAT32 ? sizeof(float) : sizeof(int16);
+}
+
+inline static int16 mix_to_int16(float sample) {
+    sample *= 32767.0f; // 32767 is the max value for 16-bit audio
+    sample = CLAMP(sample, -32768.0f, 32767.0f);
+    return (int16)sample;
+}
+
+// renders the range from its offset first_offset on and advances the oscillators
+static void mix_frames_scalar(const float *table, Oscillator *oscillators, int voice_count, Mix_Range range, int first_offset, float *samples) {
+    for (int offset = first_offset; offset < range.frame_count; offset++) {
+        float envelope = mix_envelope(range.first_frame + offset, range.tone_frame_count, range.fade_frames);
+        float combined_sample = 0;
+        for (int j = 0; j < voice_count; j++) {
+            combined_sample += oscillator_next(&oscillators[j], table) * envelope;
+        }
+        combined_sample /= voice_count;
+        samples[offset] = combined_sample;
+    }
+}
+
+static void mix_kernel_scalar(const float *table, Oscillator *oscillators, int voice_count, Mix_Range range, float *samples) {
+    mix_frames_scalar(table, oscillators, voice_count, range, 0, samples);
+}
+
+// tones are rendered, cached and queued in mono, only what goes to the device is interleaved
+// in its sample format. Every channel gets the same sample, a stereo image would weight them per sound here
+static void mix_fan_out(const float *samples, int frame_count, Sample_Format format, void *output) {
+    if (format == SAMPLE_FORMAT_FLOAT32) {
+        float *float_output = (float *)output;
+        for (int frame = 0; frame < frame_count; frame++) {
+            float sample = CLAMP(samples[frame], -1.0f, 1.0f);
+            for (int k = 0; k < SYNTHESIZER_CHANNELS; k++) {
+                float_output[frame * SYNTHESIZER_CHANNELS + k] = sample;
+            }
+        }
+        return;
+    }
+    int16 *int16_output = (int16 *)output;
+    for (int frame = 0; frame < frame_count; frame++) {
+        int16 sample = mix_to_int16(samples[frame]);
+        for (int k = 0; k < SYNTHESIZER_CHANNELS; k++) {
+            int16_output[frame * SYNTHESIZER_CHANNELS + k] = sample;
+        }
+    }
+}
+
+#ifdef MIX_KERNEL_X86
+
+__attribute__((target("sse2")))
+static void mix_kernel_sse2(const float *table, Oscillator *oscillators, int voice_count, Mix_Range range, float *samples) {
+    const int fraction_bits = 32 - OSCILLATOR_TABLE_BITS;
+    const __m128i fraction_mask = _mm_set1_epi32((1 << fraction_bits) - 1);
+    const __m128 fraction_scale = _mm_set1_ps(1.0f / (float)(1 << fraction_bits));
+    const __m128 fade = _mm_set1_ps((float)range.fade_frames);
+    const __m128 fade_out_start = _mm_set1_ps((float)(range.tone_frame_count - range.fade_frames));
+    const __m128 total_frames = _mm_set1_ps((float)range.tone_frame_count);
+    const __m128 one = _mm_set1_ps(1.0f);
+    const __m128 voices = _mm_set1_ps((float)voice_count);
+    const __m128 lane = _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f);
+
+    // no 32 bit multiply before SSE4.1, so the per lane phase offsets are made up front
+    __m128i lane_offsets[OCTAVE];
+    for (int j = 0; j < voice_count; j++) {
+        uint32 inc = oscillators[j].phase_increment;
+        lane_offsets[j] = _mm_set_epi32((int)(inc * 3), (int)(inc * 2), (int)inc, 0);
+    }
+
+    int vector_end = range.frame_count & ~3;
+    for (int offset = 0; offset < vector_end; offset += 4) {
+        __m128 f = _mm_add_ps(_mm_set1_ps((float)(range.first_frame + offset)), lane);
+        __m128 fade_in = _mm_div_ps(f, fade);
+        __m128 fade_out = _mm_div_ps(_mm_sub_ps(total_frames, f), fade);
+        __m128 in_mask = _mm_cmplt_ps(f, fade);
+        __m128 out_mask = _mm_cmpge_ps(f, fade_out_start);
+        __m128 envelope = _mm_or_ps(_mm_and_ps(out_mask, fade_out), _mm_andnot_ps(out_mask, one));
+        envelope = _mm_or_ps(_mm_and_ps(in_mask, fade_in), _mm_andnot_ps(in_mask, envelope));
+
+        __m128 combined = _mm_setzero_ps();
+        for (int j = 0; j < voice_count; j++) {
+            Oscillator *o = &oscillators[j];
+            __m128i phase = _mm_add_epi32(_mm_set1_epi32((int)o->phase), lane_offsets[j]);
+            o->phase += o->phase_increment * 4;
+
+            int idx[4];
+            _mm_storeu_si128((__m128i *)idx, _mm_srli_epi32(phase, fraction_bits));
+            __m128 fraction = _mm_mul_ps(_mm_cvtepi32_ps(_mm_and_si128(phase, fraction_mask)), fraction_scale);
+            __m128 a = _mm_set_ps(table[idx[3]], table[idx[2]], table[idx[1]], table[idx[0]]);
+            __m128 b = _mm_set_ps(table[idx[3] + 1], table[idx[2] + 1], table[idx[1] + 1], table[idx[0] + 1]);
+            __m128 sample = _mm_add_ps(a, _mm_mul_ps(_mm_sub_ps(b, a), fraction));
+            combined = _mm_add_ps(combined, _mm_mul_ps(sample, envelope));
+        }
+        _mm_storeu_ps(samples + offset, _mm_div_ps(combined, voices));
+    }
+
+    mix_frames_scalar(table, oscillators, voice_count, range, vector_end, samples);
+}
+
+__attribute__((target("avx2")))
+static void mix_kernel_avx2(const float *table, Oscillator *oscillators, int voice_count, Mix_Range range, float *samples) {
+    const int fraction_bits = 32 - OSCILLATOR_TABLE_BITS;
+    const __m256i fraction_mask = _mm256_set1_epi32((1 << fraction_bits) - 1);
+    const __m256 fraction_scale = _mm256_set1_ps(1.0f / (float)(1 << fraction_bits));
+    const __m256 fade = _mm256_set1_ps((float)range.fade_frames);
+    const __m256 fade_out_start = _mm256_set1_ps((float)(range.tone_frame_count - range.fade_frames));
+    const __m256 total_frames = _mm256_set1_ps((float)range.tone_frame_count);
+    const __m256 one = _mm256_set1_ps(1.0f);
+    const __m256 voices = _mm256_set1_ps((float)voice_count);
+    const __m256 lane = _mm256_set_ps(7.0f, 6.0f, 5.0f, 4.0f, 3.0f, 2.0f, 1.0f, 0.0f);
+    const __m256i lane_idx = _mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+
+    int vector_end = range.frame_count & ~7;
+    for (int offset = 0; offset < vector_end; offset += 8) {
+        __m256 f = _mm256_add_ps(_mm256_set1_ps((float)(range.first_frame + offset)), lane);
+        __m256 fade_in = _mm256_div_ps(f, fade);
+        __m256 fade_out = _mm256_div_ps(_mm256_sub_ps(total_frames, f), fade);
+        __m256 in_mask = _mm256_cmp_ps(f, fade, _CMP_LT_OQ);
+        __m256 out_mask = _mm256_cmp_ps(f, fade_out_start, _CMP_GE_OQ);
+        __m256 envelope = _mm256_blendv_ps(one, fade_out, out_mask);
+        envelope = _mm256_blendv_ps(envelope, fade_in, in_mask);
+
+        __m256 combined = _mm256_setzero_ps();
+        for (int j = 0; j < voice_count; j++) {
+            Oscillator *o = &oscillators[j];
+            __m256i offsets = _mm256_mullo_epi32(_mm256_set1_epi32((int)o->phase_increment), lane_idx);
+            __m256i phase = _mm256_add_epi32(_mm256_set1_epi32((int)o->phase), offsets);
+            o->phase += o->phase_increment * 8;
+
+            __m256i idx = _mm256_srli_epi32(phase, fraction_bits);
+            __m256 fraction = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_and_si256(phase, fraction_mask)), fraction_scale);
+            __m256 a = _mm256_i32gather_ps(table, idx, 4);
+            __m256 b = _mm256_i32gather_ps(table + 1, idx, 4);
+            __m256 sample = _mm256_add_ps(a, _mm256_mul_ps(_mm256_sub_ps(b, a), fraction));
+            combined = _mm256_add_ps(combined, _mm256_mul_ps(sample, envelope));
+        }
+        _mm256_storeu_ps(samples + offset, _mm256_div_ps(combined, voices));
+    }
+
+    mix_frames_scalar(table, oscillators, voice_count, range, vector_end, samples);
+}
+
+#endif
+
+static Mix_Kernel mix_kernel_select() {
+    #ifdef MIX_KERNEL_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) {
+            return mix_kernel_avx2;
+        }
+        if (__builtin_cpu_supports("sse2")) {
+            return mix_kernel_sse2;
+        }
+    #endif
+    return mix_kernel_scalar;
+}
+
+#endif
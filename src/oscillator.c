@@ -0,0 +1,61 @@
+#ifndef OSCILLATOR_C
+#define OSCILLATOR_C
+
+#include <math.h>
+
+#include "main.h"
+
+// one extra entry so interpolation never has to wrap the index
+static float oscillator_tables[WAVEFORM_COUNT][OSCILLATOR_TABLE_SIZE + 1];
+static bool oscillator_tables_ready = false;
+
+// x is the number of periods elapsed, the fractional part is the phase
+static float oscillator_formula(Waveform waveform, float x) {
+    switch (waveform) {
+    default:
+    case WAVEFORM_NONE:     return 0.0f;
+    case WAVEFORM_SINE:     return sinf(2.0f * PI * x);
+    case WAVEFORM_TRIANGLE: return 4.0f * fabsf(x - floorf(x + 0.75f) + 0.25f) - 1.0f;
+    case WAVEFORM_SQUARE:   return 4.0f * floorf(x) - 2.0f * floorf(2.0f * x) + 1.0f;
+    case WAVEFORM_SAWTOOTH: return 2.0f * (x - floorf(x + 0.5f));
+    }
+}
+
+static void oscillator_tables_init() {
+    if (oscillator_tables_ready) {
+        return;
+    }
+    for (int waveform = 0; waveform < WAVEFORM_COUNT; waveform++) {
+        for (int i = 0; i <= OSCILLATOR_TABLE_SIZE; i++) {
+            float x = (float)(i % OSCILLATOR_TABLE_SIZE) / (float)OSCILLATOR_TABLE_SIZE;
+            oscillator_tables[waveform][i] = oscillator_formula(waveform, x);
+        }
+    }
+    oscillator_tables_ready = true;
+}
+
+inline static Oscillator oscillator_create(float frequency, int sample_rate) {
+    // the phase is a 32 bit fixed point fraction of one period, so it wraps for free
+    double increment = (double)frequency / (double)sample_rate * 4294967296.0;
+    return (Oscillator) {
+        .phase = 0,
+        .phase_increment = (uint32)increment,
+    };
+}
+
+// where the oscillator is after frame steps, the wrap makes this the same as stepping there
+inline static void oscillator_seek(Oscillator *oscillator, int frame) {
+    oscillator->phase = oscillator->phase_increment * (uint32)frame;
+}
+
+inline static float oscillator_next(Oscillator *oscillator, const float *table) {
+    const int fraction_bits = 32 - OSCILLATOR_TABLE_BITS;
+    uint32 idx = oscillator->phase >> fraction_bits;
+    float fraction = (float)(oscillator->phase & ((1u << fraction_bits) - 1)) / (float)(1u << fraction_bits);
+    float a = table[idx];
+    float b = table[idx + 1];
+    oscillator->phase += oscillator->phase_increment;
+    return a + (b - a) * fraction;
+}
+
+#endif
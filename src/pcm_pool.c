@@ -0,0 +1,67 @@
+#ifndef PCM_POOL_C
+#define PCM_POOL_C
+
+#include "main.h"
+
+// the blocks of one class are a quarter octave larger than those of the class before,
+// so a block is never more than a fifth larger than what it was taken for
+static long long pcm_pool_class_bytes(int size_class) {
+    long long octave_bytes = (long long)PCM_POOL_MIN_BLOCK_BYTES << (size_class / 4);
+    return octave_bytes + octave_bytes * (size_class % 4) / 4;
+}
+
+// PCM_POOL_CLASS_COUNT when the block is too large for every class
+static int pcm_pool_class(int byte_count) {
+    int size_class = 0;
+    while (size_class < PCM_POOL_CLASS_COUNT && pcm_pool_class_bytes(size_class) < byte_count) {
+        size_class++;
+    }
+    return size_class;
+}
+
+void pcm_pool_init(Pcm_Pool *pool, long long max_free_bytes) {
+    memset(pool, 0, sizeof(*pool));
+    pool->max_free_bytes = max_free_bytes;
+}
+
+// a block of at least byte_count bytes, one given back earlier when its class has any.
+// Not locked, the owner of the pool serializes the calls
+void *pcm_pool_take(Pcm_Pool *pool, int byte_count) {
+    int size_class = pcm_pool_class(byte_count);
+    if (size_class == PCM_POOL_CLASS_COUNT) {
+        return dyn_mem_alloc(byte_count);
+    }
+    void *block = pool->free_lists[size_class];
+    if (block == NULL) {
+        return dyn_mem_alloc((int)pcm_pool_class_bytes(size_class));
+    }
+    pool->free_lists[size_class] = *(void **)block;
+    pool->free_bytes -= pcm_pool_class_bytes(size_class);
+    pool->reuses++;
+    return block;
+}
+
+// byte_count is the one the block was taken with, blocks past max_free_bytes go back to the heap
+void pcm_pool_give(Pcm_Pool *pool, void *block, int byte_count) {
+    int size_class = pcm_pool_class(byte_count);
+    if (size_class == PCM_POOL_CLASS_COUNT || pool->free_bytes + pcm_pool_class_bytes(size_class) > pool->max_free_bytes) {
+        dyn_mem_release(block);
+        return;
+    }
+    *(void **)block = pool->free_lists[size_class];
+    pool->free_lists[size_class] = block;
+    pool->free_bytes += pcm_pool_class_bytes(size_class);
+}
+
+void pcm_pool_free(Pcm_Pool *pool) {
+    for (int i = 0; i < PCM_POOL_CLASS_COUNT; i++) {
+        while (pool->free_lists[i] != NULL) {
+            void *block = pool->free_lists[i];
+            pool->free_lists[i] = *(void **)block;
+            dyn_mem_release(block);
+        }
+    }
+    pool->free_bytes = 0;
+}
+
+#endif
@@ -0,0 +1,240 @@
+// POSIX implementation of windows_wrapper.h, built instead of windows_wrapper.c on Linux and macOS
+#define _XOPEN_SOURCE 700
+
+#include <pthread.h>
+#include <sched.h>
+#include <dirent.h>
+#include <fnmatch.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+#include "windows_wrapper.h"
+
+Keyboard_Layout get_keyboard_layout() {
+    // there is no portable way to ask for the active layout
+    return KEYBOARD_LAYOUT_DEFAULT;
+}
+
+void reset_console_color() {
+    printf("\x1b[0m");
+}
+
+void set_console_color(ConsoleColor color) {
+    // the ANSI colour codes use the same red = 1, green = 2, blue = 4 bits
+    printf("\x1b[1;%dm", 30 + (color & CONSOLE_FG_WHITE));
+}
+
+void sleep_milliseconds(unsigned long milliseconds) {
+    struct timespec duration = {
+        .tv_sec = milliseconds / 1000,
+        .tv_nsec = (milliseconds % 1000) * 1000000L,
+    };
+    while (nanosleep(&duration, &duration) != 0);
+}
+
+void thread_yield() {
+    sched_yield();
+}
+
+double get_time_seconds() {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1e9;
+}
+
+void set_stdout_binary() {
+}
+
+// pattern is "<dir>/<name pattern>" as for FindFirstFile, where "*.*" also matches names without a dot
+int list_files(const char *pattern, char *buffer, int max) {
+    buffer[0] = '\0';
+
+    char dir[2048];
+    snprintf(dir, sizeof(dir), "%s", pattern);
+    char *name_pattern = strrchr(dir, '/');
+    if (name_pattern == NULL) {
+        return 1;
+    }
+    *name_pattern = '\0';
+    name_pattern++;
+    size_t name_pattern_length = strlen(name_pattern);
+    if (name_pattern_length >= 3 && strcmp(name_pattern + name_pattern_length - 3, "*.*") == 0) {
+        name_pattern[name_pattern_length - 2] = '\0';
+    }
+
+    DIR *handle = opendir(dir);
+    if (handle == NULL) {
+        return 1;
+    }
+    int amount = 0;
+    struct dirent *entry;
+    while (amount < max && (entry = readdir(handle)) != NULL) {
+        if (entry->d_name[0] == '.' || fnmatch(name_pattern, entry->d_name, 0) != 0) {
+            continue;
+        }
+        char path[4096];
+        struct stat info;
+        snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+        if (stat(path, &info) != 0 || S_ISDIR(info.st_mode)) {
+            continue;
+        }
+
+        if (amount > 0) {
+            strcat(buffer, "\n");
+        }
+        strcat(buffer, entry->d_name);
+        amount++;
+    }
+    closedir(handle);
+    return 0;
+}
+
+typedef struct Thread_Start {
+    void (*thread_function)(void *);
+    void *thread_argument;
+} Thread_Start;
+
+static void *thread_start(void *data) {
+    Thread_Start start = *(Thread_Start *)data;
+    free(data);
+    start.thread_function(start.thread_argument);
+    return NULL;
+}
+
+Thread thread_create(void (*thread_function)(void *), void *thread_argument) {
+    pthread_t *thread = (pthread_t *)malloc(sizeof(pthread_t));
+    Thread_Start *start = (Thread_Start *)malloc(sizeof(Thread_Start));
+    if (thread == NULL || start == NULL) {
+        free(thread);
+        free(start);
+        return NULL;
+    }
+    start->thread_function = thread_function;
+    start->thread_argument = thread_argument;
+    if (pthread_create(thread, NULL, thread_start, start) != 0) {
+        free(thread);
+        free(start);
+        return NULL;
+    }
+    return thread;
+}
+
+void thread_join(Thread thread) {
+    pthread_join(*(pthread_t *)thread, NULL);
+    free(thread);
+}
+
+void thread_error() {
+    pthread_exit(NULL);
+}
+
+// recursive like the Win32 mutexes, which the rest of the code relies on
+Mutex mutex_create() {
+    pthread_mutex_t *mutex = (pthread_mutex_t *)malloc(sizeof(pthread_mutex_t));
+    if (mutex == NULL) {
+        return NULL;
+    }
+    pthread_mutexattr_t attributes;
+    pthread_mutexattr_init(&attributes);
+    pthread_mutexattr_settype(&attributes, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init(mutex, &attributes);
+    pthread_mutexattr_destroy(&attributes);
+    return mutex;
+}
+
+void mutex_lock(Mutex mutex) {
+    pthread_mutex_lock((pthread_mutex_t *)mutex);
+}
+
+void mutex_unlock(Mutex mutex) {
+    pthread_mutex_unlock((pthread_mutex_t *)mutex);
+}
+
+void mutex_destroy(Mutex mutex) {
+    pthread_mutex_destroy((pthread_mutex_t *)mutex);
+    free(mutex);
+}
+
+// semaphores and events share one shape, unnamed sem_t is not available on macOS
+typedef struct Posix_Signal {
+    pthread_mutex_t mutex;
+    pthread_cond_t condition;
+    int count;
+} Posix_Signal;
+
+static Posix_Signal *posix_signal_create(int count) {
+    Posix_Signal *s = (Posix_Signal *)malloc(sizeof(Posix_Signal));
+    if (s == NULL) {
+        return NULL;
+    }
+    pthread_mutex_init(&s->mutex, NULL);
+    pthread_cond_init(&s->condition, NULL);
+    s->count = count;
+    return s;
+}
+
+static void posix_signal_wait(Posix_Signal *s) {
+    pthread_mutex_lock(&s->mutex);
+        while (s->count == 0) {
+            pthread_cond_wait(&s->condition, &s->mutex);
+        }
+        s->count--;
+    pthread_mutex_unlock(&s->mutex);
+}
+
+static void posix_signal_destroy(Posix_Signal *s) {
+    pthread_cond_destroy(&s->condition);
+    pthread_mutex_destroy(&s->mutex);
+    free(s);
+}
+
+Semaphore semaphore_create(int initial_count) {
+    return posix_signal_create(initial_count);
+}
+
+void semaphore_wait(Semaphore semaphore) {
+    posix_signal_wait((Posix_Signal *)semaphore);
+}
+
+void semaphore_post(Semaphore semaphore, int count) {
+    Posix_Signal *s = (Posix_Signal *)semaphore;
+    pthread_mutex_lock(&s->mutex);
+        s->count += count;
+        pthread_cond_broadcast(&s->condition);
+    pthread_mutex_unlock(&s->mutex);
+}
+
+void semaphore_destroy(Semaphore semaphore) {
+    posix_signal_destroy((Posix_Signal *)semaphore);
+}
+
+// auto-reset, a signal with nobody waiting is kept until the next event_wait
+Event event_create() {
+    return posix_signal_create(0);
+}
+
+void event_wait(Event event) {
+    posix_signal_wait((Posix_Signal *)event);
+}
+
+void event_signal(Event event) {
+    Posix_Signal *s = (Posix_Signal *)event;
+    pthread_mutex_lock(&s->mutex);
+        s->count = 1;
+        pthread_cond_signal(&s->condition);
+    pthread_mutex_unlock(&s->mutex);
+}
+
+void event_destroy(Event event) {
+    posix_signal_destroy((Posix_Signal *)event);
+}
+
+int get_cpu_count() {
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+}
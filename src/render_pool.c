@@ -0,0 +1,116 @@
+#ifndef RENDER_POOL_C
+#define RENDER_POOL_C
+
+#include "main.h"
+#include "windows_wrapper.h"
+
+// takes the next unclaimed job of the current batch and renders it, false when there is none left
+static bool render_pool_do_one_job(Render_Pool *pool) {
+    mutex_lock(pool->mutex);
+        if (pool->next_job >= pool->job_count) {
+            mutex_unlock(pool->mutex);
+            return false;
+        }
+        Render_Job *job = &pool->jobs[pool->next_job];
+        pool->next_job++;
+    mutex_unlock(pool->mutex);
+
+    pool->render(job);
+
+    mutex_lock(pool->mutex);
+        pool->finished_jobs++;
+        bool is_batch_done = pool->finished_jobs == pool->job_count;
+        if (is_batch_done && pool->is_caller_waiting) {
+            pool->is_caller_waiting = false;
+            semaphore_post(pool->batch_done, 1);
+        }
+    mutex_unlock(pool->mutex);
+    return true;
+}
+
+static void render_pool_worker(void *data) {
+    Render_Pool *pool = (Render_Pool *)data;
+    while (true) {
+        semaphore_wait(pool->work_available);
+        mutex_lock(pool->mutex);
+            bool should_quit = pool->should_quit;
+        mutex_unlock(pool->mutex);
+        if (should_quit) {
+            return;
+        }
+        while (render_pool_do_one_job(pool));
+    }
+}
+
+void render_pool_init(Render_Pool *pool, void (*render)(Render_Job *job)) {
+    pool->render = render;
+    pool->mutex = mutex_create();
+    pool->work_available = semaphore_create(0);
+    pool->batch_done = semaphore_create(0);
+    pool->jobs = NULL;
+    pool->job_count = 0;
+    pool->next_job = 0;
+    pool->finished_jobs = 0;
+    pool->is_caller_waiting = false;
+    pool->should_quit = false;
+
+    // the thread handing out a batch renders too, so it does not count as a worker
+    int worker_count = get_cpu_count() - 1;
+    pool->worker_count = CLAMP(worker_count, 0, RENDER_POOL_MAX_WORKERS);
+    for (int i = 0; i < pool->worker_count; i++) {
+        pool->workers[i] = thread_create(render_pool_worker, pool);
+        if (pool->workers[i] == NULL) {
+            pool->worker_count = i;
+            break;
+        }
+    }
+}
+
+// renders all jobs in parallel and returns once every one of them is finished
+void render_pool_run(Render_Pool *pool, Render_Job *jobs, int job_count) {
+    mutex_lock(pool->mutex);
+        pool->jobs = jobs;
+        pool->job_count = job_count;
+        pool->next_job = 0;
+        pool->finished_jobs = 0;
+        pool->is_caller_waiting = false;
+    mutex_unlock(pool->mutex);
+
+    int wake_count = job_count - 1 < pool->worker_count ? job_count - 1 : pool->worker_count;
+    if (wake_count > 0) {
+        semaphore_post(pool->work_available, wake_count);
+    }
+
+    while (render_pool_do_one_job(pool));
+
+    mutex_lock(pool->mutex);
+        bool is_batch_done = pool->finished_jobs == pool->job_count;
+        pool->is_caller_waiting = !is_batch_done;
+    mutex_unlock(pool->mutex);
+
+    if (!is_batch_done) {
+        semaphore_wait(pool->batch_done);
+    }
+
+    mutex_lock(pool->mutex);
+        pool->jobs = NULL;
+        pool->job_count = 0;
+        pool->next_job = 0;
+    mutex_unlock(pool->mutex);
+}
+
+void render_pool_free(Render_Pool *pool) {
+    mutex_lock(pool->mutex);
+        pool->should_quit = true;
+    mutex_unlock(pool->mutex);
+    semaphore_post(pool->work_available, pool->worker_count);
+    for (int i = 0; i < pool->worker_count; i++) {
+        thread_join(pool->workers[i]);
+    }
+    semaphore_destroy(pool->work_available);
+    semaphore_destroy(pool->batch_done);
+    mutex_destroy(pool->mutex);
+    pool->worker_count = 0;
+}
+
+#endif
@@ -1,200 +1,450 @@
 #include "raylib.h"
 #include "main.h"
 #include "windows_wrapper.h"
+#include "oscillator.c"
+#include "mix_kernel.c"
+#include "render_pool.c"
+#include "tone_cache.c"
+#include "tone_ring.c"
 
-inline static void sound_buffer_free(Sound_Buffer *buffer) {
-    for (int i = 0; i < buffer->sound_count; i++) {
-        UnloadSound(buffer->sounds[i].sound);
-        dyn_mem_release(buffer->sounds[i].raw_data);
+// raylib audio callbacks do not carry a user pointer
+static Synthesizer *stream_synthesizer = NULL;
+
+// the flags are shared with the audio thread, which never takes a lock
+inline static Synthesizer_Flags synthesizer_flags(Synthesizer *synthesizer) {
+    return __atomic_load_n(&synthesizer->flags, __ATOMIC_SEQ_CST);
+}
+
+inline static void synthesizer_set_flags(Synthesizer *synthesizer, Synthesizer_Flags flags) {
+    __atomic_fetch_or(&synthesizer->flags, flags, __ATOMIC_SEQ_CST);
+}
+
+inline static void synthesizer_clear_flags(Synthesizer *synthesizer, Synthesizer_Flags flags) {
+    __atomic_fetch_and(&synthesizer->flags, ~flags, __ATOMIC_SEQ_CST);
+}
+
+void synthesizer_sound_release(Synthesizer *synthesizer, Synthesizer_Sound *sound) {
+    if (sound->cache_entry != NULL) {
+        tone_cache_release(&synthesizer->tone_cache, sound->cache_entry);
+    }
+    sound->cache_entry = NULL;
+    sound->samples = NULL;
+    if (sound->blocks != NULL) {
+        dyn_mem_release(sound->blocks);
     }
-    buffer->sound_count = 0;
+    sound->blocks = NULL;
 }
 
-bool is_synthesizer_sound_playing(Synthesizer_Sound *s) {
-    if (s == NULL) {
-        return false;
+// expects synthesizer->mutex to be locked, returns how many sounds were reclaimed
+static int synthesizer_reclaim_played_sounds(Synthesizer *synthesizer) {
+    int reclaimed_count = 0;
+    Synthesizer_Sound *sound;
+    while ((sound = tone_ring_reclaim(&synthesizer->ring)) != NULL) {
+        synthesizer_sound_release(synthesizer, sound);
+        reclaimed_count++;
+    }
+    return reclaimed_count;
+}
+
+inline static float *synthesizer_sound_block(Synthesizer_Sound *sound, int frame) {
+    int block_idx = (frame / SYNTHESIZER_BLOCK_FRAMES) % SYNTHESIZER_AHEAD_BLOCKS;
+    return sound->blocks + block_idx * SYNTHESIZER_BLOCK_FRAMES + frame % SYNTHESIZER_BLOCK_FRAMES;
+}
+
+static void synthesizer_stream_callback(void *buffer_data, unsigned int frames) {
+    Synthesizer *synthesizer = stream_synthesizer;
+    Tone_Ring *ring = &synthesizer->ring;
+    uint8 *output = (uint8 *)buffer_data;
+    int frame_bytes = SYNTHESIZER_CHANNELS * mix_sample_bytes(synthesizer->format.sample_format);
+    int frames_left = (int)frames;
+
+    __atomic_add_fetch(&synthesizer->active_callbacks, 1, __ATOMIC_SEQ_CST);
+    while (frames_left > 0) {
+        // completed has to be read before the ring, tones pushed before it was set are visible then
+        Synthesizer_Flags flags = synthesizer_flags(synthesizer);
+        if (!has_flag(flags, SYNTHESIZER_FLAG_PLAYING)) {
+            break;
+        }
+        Synthesizer_Sound *sound = tone_ring_front(ring);
+        if (sound == NULL) {
+            // either the next tones are still being rendered (silence until they are)
+            // or there is nothing more to play
+            if (has_flag(flags, SYNTHESIZER_FLAG_COMPLETED)) {
+                synthesizer_clear_flags(synthesizer, SYNTHESIZER_FLAG_PLAYING);
+            }
+            break;
+        }
+        int current_frame = synthesizer->current_frame;
+        int frame_amount = sound->frame_count - current_frame;
+        if (frame_amount > frames_left) {
+            frame_amount = frames_left;
+        }
+        const float *samples;
+        if (sound->samples != NULL) {
+            samples = sound->samples + current_frame;
+        } else {
+            // only what the feeder has generated already, silence until it catches up
+            int generated_frames = __atomic_load_n(&sound->generated_frames, __ATOMIC_ACQUIRE);
+            if (current_frame >= generated_frames) {
+                break;
+            }
+            int block_end = (current_frame / SYNTHESIZER_BLOCK_FRAMES + 1) * SYNTHESIZER_BLOCK_FRAMES;
+            if (block_end > generated_frames) {
+                block_end = generated_frames;
+            }
+            if (frame_amount > block_end - current_frame) {
+                frame_amount = block_end - current_frame;
+            }
+            samples = synthesizer_sound_block(sound, current_frame);
+        }
+        mix_fan_out(samples, frame_amount, synthesizer->format.sample_format, output);
+        output += frame_amount * frame_bytes;
+        frames_left -= frame_amount;
+        current_frame += frame_amount;
+        if (sound->samples == NULL) {
+            // frees the block for the feeder, before the pop lets the sound be reclaimed
+            __atomic_store_n(&sound->played_frames, current_frame, __ATOMIC_RELEASE);
+        }
+        if (current_frame >= sound->frame_count) {
+            current_frame = 0;
+            tone_ring_pop(ring);
+        }
+        __atomic_store_n(&synthesizer->current_frame, current_frame, __ATOMIC_RELAXED);
+    }
+    __atomic_sub_fetch(&synthesizer->active_callbacks, 1, __ATOMIC_SEQ_CST);
+
+    if (frames_left > 0) {
+        memset(output, 0, frames_left * frame_bytes);
+    }
+}
+
+static void synthesizer_render_job(Render_Job *job);
+static void synthesizer_fill_blocks(Synthesizer *synthesizer, Synthesizer_Sound *sound);
+
+// while playing, generates the next blocks of a long tone, reclaims what the audio callback played
+// and wakes the compiler thread when that made room.
+// Sleeps on feeder_event otherwise, synthesizer_play and synthesizer_free signal it
+static void synthesizer_feeder(void *data) {
+    Synthesizer *synthesizer = (Synthesizer *)data;
+    while (true) {
+        Synthesizer_Flags flags = synthesizer_flags(synthesizer);
+        if (has_flag(flags, SYNTHESIZER_FLAG_QUIT)) {
+            return;
+        }
+        if (!has_flag(flags, SYNTHESIZER_FLAG_PLAYING)) {
+            event_wait(synthesizer->feeder_event);
+            continue;
+        }
+        mutex_lock(synthesizer->mutex);
+            Synthesizer_Sound *sound = tone_ring_playing(&synthesizer->ring);
+            if (sound != NULL && sound->blocks != NULL) {
+                synthesizer_fill_blocks(synthesizer, sound);
+            }
+            int reclaimed_count = synthesizer_reclaim_played_sounds(synthesizer);
+        mutex_unlock(synthesizer->mutex);
+        if (reclaimed_count > 0) {
+            event_signal(synthesizer->space_available_event);
+        }
+        sleep_milliseconds(SYNTHESIZER_FEED_MILLISECONDS);
     }
+}
+
+// enough to render tones, without any audio device or playback state
+void synthesizer_init_offline(Synthesizer *synthesizer, Audio_Format format) {
+    oscillator_tables_init();
+    synthesizer->format = format;
+    synthesizer->oscillator_mode = OSCILLATOR_MODE_WAVETABLE;
+    synthesizer->mix_kernel = mix_kernel_select();
+    synthesizer->generates_ahead = false;
+    render_pool_init(&synthesizer->render_pool, synthesizer_render_job);
+    tone_cache_init(&synthesizer->tone_cache, TONE_CACHE_DEFAULT_MAX_ENTRIES, TONE_CACHE_DEFAULT_MAX_BYTES);
+}
 
-    return IsSoundPlaying(s->sound);
+void synthesizer_free_offline(Synthesizer *synthesizer) {
+    render_pool_free(&synthesizer->render_pool);
+    tone_cache_free(&synthesizer->tone_cache);
 }
 
-void synthesizer_init(Synthesizer *synthesizer) {
-    synthesizer->current_sound_idx = -1;
-    for (int i = 0; i < 2; i++) {
-        synthesizer->buffers[i].mutex = mutex_create();
+// ring_depth is how many rendered tones may be queued ahead of playback,
+// it needs room for a second batch to be rendered while the first one plays
+void synthesizer_init(Synthesizer *synthesizer, Audio_Format format, int ring_depth) {
+    synthesizer_init_offline(synthesizer, format);
+    synthesizer->generates_ahead = true;
+    synthesizer->mutex = mutex_create();
+    synthesizer->feeder_event = event_create();
+    synthesizer->space_available_event = event_create();
+    ASSERT(ring_depth >= 2 * SYNTHESIZER_TONE_CAPACITY);
+    tone_ring_init(&synthesizer->ring, ring_depth);
+
+    stream_synthesizer = synthesizer;
+    SetAudioStreamBufferSizeDefault(SYNTHESIZER_STREAM_BUFFER_FRAMES);
+    int sample_size = mix_sample_bytes(format.sample_format) * 8;
+    synthesizer->stream = LoadAudioStream(format.sample_rate, sample_size, SYNTHESIZER_CHANNELS);
+    SetAudioStreamCallback(synthesizer->stream, synthesizer_stream_callback);
+
+    synthesizer->feeder = thread_create(synthesizer_feeder, synthesizer);
+    if (synthesizer->feeder == NULL) {
+        thread_error();
     }
-    synthesizer->front_buffer = &synthesizer->buffers[0];
-    synthesizer->back_buffer = &synthesizer->buffers[1];
 }
 
 void synthesizer_cancel(Synthesizer *synthesizer) {
-    synthesizer->flags |= SYNTHESIZER_FLAG_SHOULD_CANCEL;
+    synthesizer_set_flags(synthesizer, SYNTHESIZER_FLAG_SHOULD_CANCEL);
+    event_signal(synthesizer->space_available_event);
 }
 
 void synthesizer_reset(Synthesizer *synthesizer) {
-    synthesizer->flags = SYNTHESIZER_FLAG_NONE;
-    for (int i = 0; i < 2; i++) {
-        Sound_Buffer *b = &synthesizer->buffers[i];
-        mutex_lock(b->mutex);
-            sound_buffer_free(b);
-        mutex_unlock(b->mutex);
+    StopAudioStream(synthesizer->stream);
+    synthesizer_clear_flags(synthesizer, SYNTHESIZER_FLAG_PLAYING);
+    synthesizer_cancel(synthesizer);
+    // a callback that saw the playing flag may still be reading from the ring
+    while (__atomic_load_n(&synthesizer->active_callbacks, __ATOMIC_SEQ_CST) > 0) {
+        thread_yield();
     }
-    synthesizer->current_sound_idx = -1;
+
+    mutex_lock(synthesizer->mutex);
+        tone_ring_drop_all(&synthesizer->ring);
+        synthesizer_reclaim_played_sounds(synthesizer);
+        synthesizer->current_frame = 0;
+        __atomic_store_n(&synthesizer->flags, SYNTHESIZER_FLAG_NONE, __ATOMIC_SEQ_CST);
+    mutex_unlock(synthesizer->mutex);
 }
 
-void synthesizer_back_buffer_generate_data(Synthesizer *synthesizer, Compiler *compiler) {
-    Sound_Buffer *back_buffer = synthesizer->back_buffer;
+void synthesizer_free(Synthesizer *synthesizer) {
+    synthesizer_reset(synthesizer);
+    synthesizer_set_flags(synthesizer, SYNTHESIZER_FLAG_QUIT);
+    event_signal(synthesizer->feeder_event);
+    thread_join(synthesizer->feeder);
+    UnloadAudioStream(synthesizer->stream);
+    stream_synthesizer = NULL;
+    tone_ring_free(&synthesizer->ring);
+    event_destroy(synthesizer->space_available_event);
+    event_destroy(synthesizer->feeder_event);
+    mutex_destroy(synthesizer->mutex);
+    synthesizer_free_offline(synthesizer);
+}
 
-    mutex_lock(back_buffer->mutex);
-        for (int i = 0; i < compiler->tone_amount; i++) {
-            back_buffer->sounds[i].tone = compiler->tones[i];
-            back_buffer->sound_count++;
-        }
-    mutex_unlock(back_buffer->mutex);
+inline static int synthesizer_tone_frame_count(Synthesizer *synthesizer, Tone *tone) {
+    return duration_frame_count(tone->duration, synthesizer->format.sample_rate);
+}
 
-    if (back_buffer->sound_count == 0) {
-        synthesizer->flags |= SYNTHESIZER_FLAG_COMPLETED;
+// renders the frames of the range, a tone is rendered the same whether it is done in one go or in ranges
+static void synthesizer_render_range(Synthesizer *synthesizer, Tone *tone, Mix_Range range, float *samples) {
+    const int sample_rate = synthesizer->format.sample_rate;
+
+    Chord *chord = &tone->chord;
+
+    bool is_chord_silent = (
+        tone->waveform == WAVEFORM_NONE ||
+        chord->size <= 0 ||
+        chord->size > OCTAVE
+    );
+    if (is_chord_silent) {
+        memset(samples, 0, range.frame_count * sizeof(float));
+        return;
+    }
+
+    if (synthesizer->oscillator_mode == OSCILLATOR_MODE_WAVETABLE) {
+        Oscillator oscillators[OCTAVE];
+        for (int j = 0; j < chord->size; j++) {
+            oscillators[j] = oscillator_create(chord->frequencies[j], sample_rate);
+            oscillator_seek(&oscillators[j], range.first_frame);
+        }
+        synthesizer->mix_kernel(oscillator_tables[tone->waveform], oscillators, chord->size, range, samples);
         return;
     }
 
-    back_buffer->sound_count = 0;
+    for (int offset = 0; offset < range.frame_count; offset++) {
+        int frame = range.first_frame + offset;
+        float envelope = mix_envelope(frame, range.tone_frame_count, range.fade_frames);
+        float combined_sample = 0;
+        for (int j = 0; j < chord->size; j++) {
+            float x = chord->frequencies[j] * (float)frame / (float)sample_rate;
+            combined_sample += oscillator_formula(tone->waveform, x) * envelope;
+        }
+        combined_sample /= chord->size;
+        samples[offset] = combined_sample;
+    }
+}
 
-    const int sample_rate = 44100;
-    const int channels = 2;
-    const int sample_size = 16; // 16 bits per sample
-    const int bytes_per_sample = sample_size / 8;
+static void synthesizer_render_tone(Synthesizer *synthesizer, Tone *tone, float *samples, int frame_count) {
+    Mix_Range range = {
+        .first_frame = 0,
+        .frame_count = frame_count,
+        .tone_frame_count = frame_count,
+        .fade_frames = mix_fade_frames(synthesizer->format.sample_rate),
+    };
+    synthesizer_render_range(synthesizer, tone, range, samples);
+}
 
-    for (int i = 0; i < SYNTHESIZER_TONE_CAPACITY; i++) {
-        int frame_count = (int)(back_buffer->sounds[i].tone.duration * (float)sample_rate);
-        int data_size = frame_count * channels * bytes_per_sample;
-        int16 *audio_data = (int16 *)dyn_mem_alloc(data_size);
-        if (audio_data == NULL) {
-            thread_error();
+// generates the blocks of a long tone up to SYNTHESIZER_AHEAD_BLOCKS past the one being played,
+// never the one being played itself
+static void synthesizer_fill_blocks(Synthesizer *synthesizer, Synthesizer_Sound *sound) {
+    int played_block = __atomic_load_n(&sound->played_frames, __ATOMIC_ACQUIRE) / SYNTHESIZER_BLOCK_FRAMES;
+    int generated_frames = sound->generated_frames;
+    while (generated_frames < sound->frame_count && generated_frames / SYNTHESIZER_BLOCK_FRAMES < played_block + SYNTHESIZER_AHEAD_BLOCKS) {
+        int frame_count = sound->frame_count - generated_frames;
+        if (frame_count > SYNTHESIZER_BLOCK_FRAMES) {
+            frame_count = SYNTHESIZER_BLOCK_FRAMES;
         }
-        bool is_chord_silent = (back_buffer->sounds[i].tone.chord.size <= 0);
-        if (is_chord_silent) {
-            for (int frame = 0; frame < frame_count; frame += 1) {
-                for (int k = 0; k < channels; k++) {
-                    audio_data[frame * channels + k] = 0;
-                }
-            }
-        } else {
-            for (int frame = 0; frame < frame_count; frame += 1) {
-                Chord *chord = &back_buffer->sounds[i].tone.chord;
-                float samples[chord->size];
-                switch (back_buffer->sounds[i].tone.waveform) {
-                case WAVEFORM_NONE: {
-                    for (int j = 0; j < chord->size; j++) {
-                        samples[j] = 0;
-                    }
-                } break;
-                case WAVEFORM_SINE: {
-                    for (int j = 0; j < chord->size; j++) {
-                        float x = chord->frequencies[j] * (float)frame / (float)sample_rate;
-                        samples[j] = sinf(2.0f * PI * x);
-                    }
-                } break;
-                case WAVEFORM_TRIANGLE: {
-                    for (int j = 0; j < chord->size; j++) {
-                        float x = chord->frequencies[j] * (float)frame / (float)sample_rate;
-                        samples[j] = 4.0f * fabsf(x - floorf(x + 0.75f) + 0.25f) - 1.0f;
-                    }
-                } break;
-                case WAVEFORM_SQUARE: {
-                    for (int j = 0; j < chord->size; j++) {
-                        float x = chord->frequencies[j] * (float)frame / (float)sample_rate;
-                        samples[j] = 4.0f * floorf(x) - 2.0f * floorf(2.0f * x) + 1.0f;
-                    }
-                } break;
-                case WAVEFORM_SAWTOOTH: {
-                    for (int j = 0; j < chord->size; j++) {
-                        float x = chord->frequencies[j] * (float)frame / (float)sample_rate;
-                        samples[j] = 2.0f * (x - floorf(x + 0.5f));
-                    }
-                } break;
-                }
+        Mix_Range range = {
+            .first_frame = generated_frames,
+            .frame_count = frame_count,
+            .tone_frame_count = sound->frame_count,
+            .fade_frames = mix_fade_frames(synthesizer->format.sample_rate),
+        };
+        synthesizer_render_range(synthesizer, &sound->tone, range, synthesizer_sound_block(sound, generated_frames));
+        generated_frames += frame_count;
+        __atomic_store_n(&sound->generated_frames, generated_frames, __ATOMIC_RELEASE);
+    }
+}
 
-                float envelope; // Default to full volume
-                if (frame < SYNTHESIZER_FADE_FRAMES) {
-                    // Fade-in
-                    envelope = (float)frame / (float)SYNTHESIZER_FADE_FRAMES;
-                } else if (frame >= frame_count - SYNTHESIZER_FADE_FRAMES) {
-                    // Fade-out
-                    envelope = (float)(frame_count - frame) / (float)SYNTHESIZER_FADE_FRAMES;
-                } else {
-                    envelope = 1.0f;
-                }
+// frames [first_frame, first_frame + frame_count) of the sound. Offline a sound too long to be rendered ahead
+// has no samples, its frames are generated into block, which limits frame_count to SYNTHESIZER_BLOCK_FRAMES
+static const float *synthesizer_sound_frames(Synthesizer *synthesizer, Synthesizer_Sound *sound, int first_frame, int frame_count, float *block) {
+    if (sound->samples != NULL) {
+        return sound->samples + first_frame;
+    }
+    ASSERT(frame_count <= SYNTHESIZER_BLOCK_FRAMES);
+    Mix_Range range = {
+        .first_frame = first_frame,
+        .frame_count = frame_count,
+        .tone_frame_count = sound->frame_count,
+        .fade_frames = mix_fade_frames(synthesizer->format.sample_rate),
+    };
+    synthesizer_render_range(synthesizer, &sound->tone, range, block);
+    return block;
+}
 
-                float combined_sample = 0;
-                for (int j = 0; j < chord->size; j++) {
-                    combined_sample += (samples[j] * envelope);
-                }
-                combined_sample /= chord->size;
+static void synthesizer_render_job(Render_Job *job) {
+    synthesizer_render_tone(job->synthesizer, job->tone, job->samples, job->frame_count);
+}
 
-                for (int k = 0; k < channels; k++) {
-                    audio_data[frame * channels + k] = (int16_t)(combined_sample * 32767); // 32767 is the max value for 16-bit audio
+// renders the tones missing from the tone cache in parallel on the render pool,
+// every sound holds a cache reference afterwards which synthesizer_sound_release gives back
+static void synthesizer_render_tones(Synthesizer *synthesizer, Tone *tones, int tone_count, Synthesizer_Sound *sounds) {
+    Render_Job jobs[SYNTHESIZER_TONE_CAPACITY];
+    Tone_Cache_Entry *rendered[SYNTHESIZER_TONE_CAPACITY];
+    int job_count = 0;
+    ASSERT(tone_count <= SYNTHESIZER_TONE_CAPACITY);
+
+    for (int i = 0; i < tone_count; i++) {
+        int frame_count = synthesizer_tone_frame_count(synthesizer, &tones[i]);
+        if (frame_count > SYNTHESIZER_MAX_RENDERED_FRAMES) {
+            // generated while it plays, however long it lasts it never takes more than its ring of blocks
+            sounds[i] = (Synthesizer_Sound) { .tone = tones[i], .frame_count = frame_count };
+            if (synthesizer->generates_ahead) {
+                sounds[i].blocks = (float *)dyn_mem_alloc(SYNTHESIZER_AHEAD_BLOCKS * SYNTHESIZER_BLOCK_FRAMES * sizeof(float));
+                if (sounds[i].blocks == NULL) {
+                    thread_error();
                 }
+                synthesizer_fill_blocks(synthesizer, &sounds[i]);
             }
+            continue;
         }
+        Tone_Cache_Key key = tone_cache_key(synthesizer->oscillator_mode, synthesizer->format.sample_rate, &tones[i], frame_count);
+        Tone_Cache_Entry *entry = tone_cache_acquire(&synthesizer->tone_cache, &key);
 
-        Wave wave;
-        wave.frameCount = frame_count;
-        wave.sampleRate = sample_rate;
-        wave.sampleSize = sample_size;
-        wave.channels = channels;
-        wave.data = audio_data;
-
-        mutex_lock(back_buffer->mutex);
-            back_buffer->sounds[i].raw_data = audio_data;
-            back_buffer->sounds[i].sound = LoadSoundFromWave(wave);
-            back_buffer->sound_count++;
-            if (i >= (compiler->tone_amount - 1)) {
-                synthesizer->flags |= SYNTHESIZER_FLAG_SOUND_BUFFER_SWAP_REQUIRED;
-                mutex_unlock(back_buffer->mutex);
-                break;
+        // the same tone repeated within the batch only has to be rendered once
+        for (int j = 0; entry == NULL && j < job_count; j++) {
+            if (tone_cache_key_equals(&rendered[j]->key, &key)) {
+                entry = rendered[j];
+                entry->ref_count++;
             }
-        mutex_unlock(back_buffer->mutex);
-
-        if (has_flag(synthesizer->flags, SYNTHESIZER_FLAG_SHOULD_CANCEL)) {
-            for (int i = 0; i < 2; i++) {
-                Sound_Buffer *b = &synthesizer->buffers[i];
-                mutex_lock(b->mutex);
-                    sound_buffer_free(b);
-                mutex_unlock(b->mutex);
+        }
+
+        if (entry == NULL) {
+            entry = tone_cache_entry_create(&synthesizer->tone_cache, &key);
+            if (entry == NULL) {
+                thread_error();
             }
-            break;
+            rendered[job_count] = entry;
+            jobs[job_count] = (Render_Job) {
+                .synthesizer = synthesizer,
+                .tone = &tones[i],
+                .samples = entry->samples,
+                .frame_count = frame_count,
+            };
+            job_count++;
         }
+        sounds[i] = (Synthesizer_Sound) {
+            .tone = tones[i],
+            .cache_entry = entry,
+            .samples = entry->samples,
+            .frame_count = frame_count,
+        };
     }
-}
 
-Synthesizer_Sound *synthesizer_front_buffer_try_get_sound(Synthesizer *synthesizer) {
-    Sound_Buffer *front_buffer = synthesizer->front_buffer;
-    mutex_lock(front_buffer->mutex);
-        if (synthesizer->current_sound_idx >= (front_buffer->sound_count - 1)) {
-            mutex_unlock(front_buffer->mutex);
-            return NULL;
-        }
-        synthesizer->current_sound_idx++;
-    mutex_unlock(front_buffer->mutex);
-    return &(front_buffer->sounds[synthesizer->current_sound_idx]);
+    render_pool_run(&synthesizer->render_pool, jobs, job_count);
+
+    for (int j = 0; j < job_count; j++) {
+        tone_cache_insert(&synthesizer->tone_cache, rendered[j]);
+    }
 }
 
-bool synthesizer_swap_sound_buffers(Synthesizer *synthesizer) {
-    mutex_lock(synthesizer->front_buffer->mutex);
-    mutex_lock(synthesizer->back_buffer->mutex);
+// renders the compiler's tones and queues them for playback, waiting while the ring has no room for them
+void synthesizer_queue_tones(Synthesizer *synthesizer, Compiler *compiler) {
+    int tone_count = compiler->tone_amount;
+    if (tone_count == 0) {
+        synthesizer_set_flags(synthesizer, SYNTHESIZER_FLAG_COMPLETED);
+        return;
+    }
 
-    Sound_Buffer *temp_buffer = synthesizer->front_buffer;
-    synthesizer->front_buffer = synthesizer->back_buffer;
-    synthesizer->back_buffer = temp_buffer;
+    while (true) {
+        mutex_lock(synthesizer->mutex);
+            synthesizer_reclaim_played_sounds(synthesizer);
+            bool has_room = tone_ring_free_slots(&synthesizer->ring) >= (uint32)tone_count;
+        mutex_unlock(synthesizer->mutex);
+        if (has_room) {
+            break;
+        }
+        if (has_flag(synthesizer_flags(synthesizer), SYNTHESIZER_FLAG_SHOULD_CANCEL)) {
+            return;
+        }
+        // signalled by the feeder once it reclaimed what the audio callback played, and on cancel
+        event_wait(synthesizer->space_available_event);
+    }
 
-    sound_buffer_free(synthesizer->back_buffer);
+    Synthesizer_Sound sounds[SYNTHESIZER_TONE_CAPACITY];
+    synthesizer_render_tones(synthesizer, compiler->tones, tone_count, sounds);
 
-    bool has_sounds = synthesizer->front_buffer->sound_count > 0;
+    mutex_lock(synthesizer->mutex);
+        bool is_cancelled = has_flag(synthesizer_flags(synthesizer), SYNTHESIZER_FLAG_SHOULD_CANCEL);
+        for (int i = 0; i < tone_count; i++) {
+            if (is_cancelled || !tone_ring_push(&synthesizer->ring, &sounds[i])) {
+                synthesizer_sound_release(synthesizer, &sounds[i]);
+            }
+        }
+        if (!is_cancelled && !has_flag(compiler->flags, COMPILER_FLAG_IN_PROCESS)) {
+            synthesizer_set_flags(synthesizer, SYNTHESIZER_FLAG_COMPLETED);
+        }
+    mutex_unlock(synthesizer->mutex);
+}
 
-    mutex_unlock(synthesizer->front_buffer->mutex);
-    mutex_unlock(synthesizer->back_buffer->mutex);
+bool synthesizer_play(Synthesizer *synthesizer) {
+    bool has_sounds = tone_ring_front(&synthesizer->ring) != NULL;
+    if (has_sounds) {
+        synthesizer->current_frame = 0;
+        synthesizer_set_flags(synthesizer, SYNTHESIZER_FLAG_PLAYING);
+        event_signal(synthesizer->feeder_event);
+        PlayAudioStream(synthesizer->stream);
+    }
+    return has_sounds;
+}
 
-    synthesizer->current_sound_idx = -1;
+bool synthesizer_is_playing(Synthesizer *synthesizer) {
+    return has_flag(synthesizer_flags(synthesizer), SYNTHESIZER_FLAG_PLAYING);
+}
 
-    return has_sounds;
+// the tone and time are only for display, the head is read again so a sound popped meanwhile is not reported
+bool synthesizer_get_current_tone(Synthesizer *synthesizer, Tone *tone, float *time) {
+    Tone_Ring *ring = &synthesizer->ring;
+    uint32 head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    if (head == __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE)) {
+        return false;
+    }
+    *tone = tone_ring_slot(ring, head)->tone;
+    int current_frame = __atomic_load_n(&synthesizer->current_frame, __ATOMIC_RELAXED);
+    *time = (float)current_frame / (float)synthesizer->format.sample_rate;
+    return head == __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
 }
@@ -62,13 +62,1173 @@ static void test_equal_char(char *left_name, char left_value, char *right_name,
     validate_test(left_value == right_value);
 }
 
+static float oscillator_max_error(Waveform waveform, float frequency, int frame_count, int *mismatches) {
+    oscillator_tables_init();
+    Oscillator oscillator = oscillator_create(frequency, SYNTHESIZER_DEFAULT_SAMPLE_RATE);
+    float max_error = 0;
+    *mismatches = 0;
+    for (int frame = 0; frame < frame_count; frame++) {
+        // reference phase in double precision, the float formula itself drifts for high frames
+        double x = (double)frequency * (double)frame / (double)SYNTHESIZER_DEFAULT_SAMPLE_RATE;
+        float expected = oscillator_formula(waveform, (float)(x - floor(x)));
+        float error = fabsf(oscillator_next(&oscillator, oscillator_tables[waveform]) - expected);
+        if (error > 1e-3f) {
+            (*mismatches)++;
+        }
+        if (error > max_error) {
+            max_error = error;
+        }
+    }
+    return max_error;
+}
+
+static void test_oscillators() {
+    printf("TEST WAVETABLE OSCILLATORS AGAINST FORMULAS:\n");
+    const int frame_count = 4096;
+    const float frequencies[3] = { 55.0f, 440.0f, 3520.0f };
+    for (int i = 0; i < 3; i++) {
+        int mismatches;
+        float periods = frequencies[i] * frame_count / (float)SYNTHESIZER_DEFAULT_SAMPLE_RATE;
+
+        TEST_TRUE(oscillator_max_error(WAVEFORM_SINE, frequencies[i], frame_count, &mismatches) < 1e-4f);
+        TEST_TRUE(oscillator_max_error(WAVEFORM_TRIANGLE, frequencies[i], frame_count, &mismatches) < 1e-3f);
+
+        // interpolating across a discontinuity is off for at most one frame per edge
+        oscillator_max_error(WAVEFORM_SQUARE, frequencies[i], frame_count, &mismatches);
+        TEST_TRUE(mismatches <= (int)(2.0f * periods) + 4);
+        oscillator_max_error(WAVEFORM_SAWTOOTH, frequencies[i], frame_count, &mismatches);
+        TEST_TRUE(mismatches <= (int)periods + 4);
+    }
+}
+
+// compared as the int16 samples the device gets
+static int mix_kernel_max_difference(Mix_Kernel kernel, Waveform waveform, int voice_count, int frame_count) {
+    static float expected[SYNTHESIZER_DEFAULT_SAMPLE_RATE];
+    static float actual[SYNTHESIZER_DEFAULT_SAMPLE_RATE];
+    Mix_Range range = {
+        .first_frame = 0,
+        .frame_count = frame_count,
+        .tone_frame_count = frame_count,
+        .fade_frames = mix_fade_frames(SYNTHESIZER_DEFAULT_SAMPLE_RATE),
+    };
+    Oscillator expected_oscillators[OCTAVE];
+    Oscillator actual_oscillators[OCTAVE];
+    for (int j = 0; j < voice_count; j++) {
+        float frequency = 110.0f * (1.0f + j * 0.37f);
+        expected_oscillators[j] = oscillator_create(frequency, SYNTHESIZER_DEFAULT_SAMPLE_RATE);
+        actual_oscillators[j] = expected_oscillators[j];
+    }
+    mix_kernel_scalar(oscillator_tables[waveform], expected_oscillators, voice_count, range, expected);
+    kernel(oscillator_tables[waveform], actual_oscillators, voice_count, range, actual);
+    int max_difference = 0;
+    for (int i = 0; i < frame_count; i++) {
+        int difference = abs(mix_to_int16(expected[i]) - mix_to_int16(actual[i]));
+        if (difference > max_difference) {
+            max_difference = difference;
+        }
+    }
+    return max_difference;
+}
+
+static void test_mix_kernels() {
+    printf("TEST VECTORIZED MIX KERNELS AGAINST SCALAR:\n");
+    oscillator_tables_init();
+    Mix_Kernel kernels[3] = { mix_kernel_scalar };
+    int kernel_count = 1;
+    #ifdef MIX_KERNEL_X86
+        if (__builtin_cpu_supports("sse2")) {
+            kernels[kernel_count++] = mix_kernel_sse2;
+        }
+        if (__builtin_cpu_supports("avx2")) {
+            kernels[kernel_count++] = mix_kernel_avx2;
+        }
+    #endif
+    const int frame_counts[3] = { 7, mix_fade_frames(SYNTHESIZER_DEFAULT_SAMPLE_RATE) + 3, SYNTHESIZER_DEFAULT_SAMPLE_RATE - 5 };
+    for (int k = 0; k < kernel_count; k++) {
+        int max_difference = 0;
+        for (int waveform = WAVEFORM_SINE; waveform < WAVEFORM_COUNT; waveform++) {
+            for (int voice_count = 1; voice_count <= OCTAVE; voice_count++) {
+                for (int i = 0; i < 3; i++) {
+                    int difference = mix_kernel_max_difference(kernels[k], waveform, voice_count, frame_counts[i]);
+                    if (difference > max_difference) {
+                        max_difference = difference;
+                    }
+                }
+            }
+        }
+        // one step of int16 covers float rounding differences between instruction sets
+        TEST_TRUE(max_difference <= 1);
+    }
+
+    float samples[2] = { 0.5f, -2.0f };
+    int16 output[2 * SYNTHESIZER_CHANNELS];
+    mix_fan_out(samples, 2, SAMPLE_FORMAT_INT16, output);
+    for (int k = 0; k < SYNTHESIZER_CHANNELS; k++) {
+        TEST_EQUAL_INT(output[k], 16383);
+        TEST_EQUAL_INT(output[SYNTHESIZER_CHANNELS + k], -32768);
+    }
+}
+
+static void test_audio_format() {
+    printf("TEST SAMPLE RATES AND FORMATS:\n");
+    TEST_EQUAL_INT(mix_fade_frames(44100), 500);
+    TEST_EQUAL_INT(mix_fade_frames(22050), 250);
+    TEST_EQUAL_INT(mix_fade_frames(48000), 544);
+
+    Tone tone = {0};
+    tone.waveform = WAVEFORM_SINE;
+    tone.chord.size = 1;
+    tone.chord.frequencies[0] = 440.0f;
+    tone.duration = 0.5f;
+
+    // half a second at 44.1 kHz has as many frames as a second at 22.05 kHz, but is another tone
+    Tone longer_tone = tone;
+    longer_tone.duration = 1.0f;
+    Tone_Cache_Key key = tone_cache_key(OSCILLATOR_MODE_WAVETABLE, 44100, &tone, 22050);
+    Tone_Cache_Key longer_key = tone_cache_key(OSCILLATOR_MODE_WAVETABLE, 22050, &longer_tone, 22050);
+    TEST_TRUE(!tone_cache_key_equals(&key, &longer_key));
+
+    const int sample_rates[3] = { 22050, 44100, 48000 };
+    for (int i = 0; i < 3; i++) {
+        Synthesizer synthesizer = {0};
+        Audio_Format format = { sample_rates[i], SAMPLE_FORMAT_INT16 };
+        synthesizer_init_offline(&synthesizer, format);
+        Synthesizer_Sound sound;
+        synthesizer_render_tones(&synthesizer, &tone, 1, &sound);
+        TEST_EQUAL_INT(sound.frame_count, sample_rates[i] / 2);
+        // the fade in ends at the same time at every rate
+        int fade_frames = mix_fade_frames(sample_rates[i]);
+        int louder_than_envelope = 0;
+        float peak = 0.0f;
+        for (int frame = 0; frame < fade_frames; frame++) {
+            float sample = fabsf(sound.samples[frame]);
+            louder_than_envelope += sample > mix_envelope(frame, sound.frame_count, fade_frames) + 1e-3f;
+            peak = sample > peak ? sample : peak;
+        }
+        TEST_EQUAL_INT(louder_than_envelope, 0);
+        TEST_TRUE(peak > 0.5f);
+        synthesizer_sound_release(&synthesizer, &sound);
+        synthesizer_free_offline(&synthesizer);
+    }
+
+    float samples[2] = { 0.5f, -2.0f };
+    float output[2 * SYNTHESIZER_CHANNELS];
+    mix_fan_out(samples, 2, SAMPLE_FORMAT_FLOAT32, output);
+    for (int k = 0; k < SYNTHESIZER_CHANNELS; k++) {
+        TEST_TRUE(output[k] == 0.5f);
+        TEST_TRUE(output[SYNTHESIZER_CHANNELS + k] == -1.0f);
+    }
+}
+
+static void test_render_pool() {
+    printf("TEST RENDER POOL AGAINST SERIAL RENDERING:\n");
+    Synthesizer synthesizer = {0};
+    synthesizer_init_offline(&synthesizer, AUDIO_FORMAT_DEFAULT);
+
+    Tone tones[SYNTHESIZER_TONE_CAPACITY] = {0};
+    for (int i = 0; i < SYNTHESIZER_TONE_CAPACITY; i++) {
+        tones[i].waveform = (i % (WAVEFORM_COUNT - 1)) + 1;
+        tones[i].chord.size = 1 + i;
+        for (int j = 0; j < tones[i].chord.size; j++) {
+            tones[i].chord.frequencies[j] = 220.0f + 33.0f * j;
+        }
+        tones[i].duration = 0.05f * (1 + i);
+    }
+
+    Synthesizer_Sound sounds[SYNTHESIZER_TONE_CAPACITY];
+    synthesizer_render_tones(&synthesizer, tones, SYNTHESIZER_TONE_CAPACITY, sounds);
+
+    int mismatching_tones = 0;
+    for (int i = 0; i < SYNTHESIZER_TONE_CAPACITY; i++) {
+        int frame_count = synthesizer_tone_frame_count(&synthesizer, &tones[i]);
+        float *expected = (float *)dyn_mem_alloc(frame_count * sizeof(float));
+        synthesizer_render_tone(&synthesizer, &tones[i], expected, frame_count);
+        bool is_same = sounds[i].frame_count == frame_count &&
+            memcmp(expected, sounds[i].samples, frame_count * sizeof(float)) == 0;
+        if (!is_same) {
+            mismatching_tones++;
+        }
+        dyn_mem_release(expected);
+        synthesizer_sound_release(&synthesizer, &sounds[i]);
+    }
+    TEST_EQUAL_INT(mismatching_tones, 0);
+
+    synthesizer_free_offline(&synthesizer);
+}
+
+static void test_generated_tones() {
+    printf("TEST LONG TONES GENERATED A BLOCK AT A TIME:\n");
+    Synthesizer synthesizer = {0};
+    synthesizer_init_offline(&synthesizer, AUDIO_FORMAT_DEFAULT);
+
+    Tone tone = {0};
+    tone.waveform = WAVEFORM_SAWTOOTH;
+    tone.chord.size = 3;
+    tone.chord.frequencies[0] = 220.0f;
+    tone.chord.frequencies[1] = 277.18f;
+    tone.chord.frequencies[2] = 329.63f;
+    tone.duration = 3.0f;
+    int frame_count = synthesizer_tone_frame_count(&synthesizer, &tone);
+    TEST_TRUE(frame_count > SYNTHESIZER_MAX_RENDERED_FRAMES);
+
+    int heap_count = dyn_mem_allocations[DYN_MEM_TAG_HEAP];
+    Synthesizer_Sound sound;
+    synthesizer_render_tones(&synthesizer, &tone, 1, &sound);
+    TEST_TRUE(sound.samples == NULL);
+    TEST_EQUAL_INT(sound.frame_count, frame_count);
+    TEST_EQUAL_INT(dyn_mem_allocations[DYN_MEM_TAG_HEAP], heap_count);
+    TEST_EQUAL_INT(synthesizer.tone_cache.entry_count, 0);
+
+    // block by block the tone comes out exactly as rendered in one go
+    float *expected = (float *)dyn_mem_alloc(frame_count * sizeof(float));
+    for (int mode = OSCILLATOR_MODE_WAVETABLE; mode <= OSCILLATOR_MODE_FORMULA; mode++) {
+        synthesizer.oscillator_mode = mode;
+        synthesizer_render_tone(&synthesizer, &tone, expected, frame_count);
+        int mismatching_blocks = 0;
+        float block[SYNTHESIZER_BLOCK_FRAMES];
+        for (int first_frame = 0; first_frame < frame_count; first_frame += SYNTHESIZER_BLOCK_FRAMES) {
+            int block_frames = frame_count - first_frame;
+            if (block_frames > SYNTHESIZER_BLOCK_FRAMES) {
+                block_frames = SYNTHESIZER_BLOCK_FRAMES;
+            }
+            const float *samples = synthesizer_sound_frames(&synthesizer, &sound, first_frame, block_frames, block);
+            mismatching_blocks += memcmp(samples, expected + first_frame, block_frames * sizeof(float)) != 0;
+        }
+        TEST_EQUAL_INT(mismatching_blocks, 0);
+    }
+    synthesizer_sound_release(&synthesizer, &sound);
+
+    // played live its blocks are generated ahead, never further than the ring of blocks
+    synthesizer.oscillator_mode = OSCILLATOR_MODE_WAVETABLE;
+    synthesizer.generates_ahead = true;
+    synthesizer_render_tone(&synthesizer, &tone, expected, frame_count);
+    synthesizer_render_tones(&synthesizer, &tone, 1, &sound);
+    TEST_TRUE(sound.blocks != NULL);
+    TEST_EQUAL_INT(sound.generated_frames, SYNTHESIZER_AHEAD_BLOCKS * SYNTHESIZER_BLOCK_FRAMES);
+    int mismatching_reads = 0;
+    int overruns = 0;
+    while (sound.played_frames < frame_count) {
+        int block_end = (sound.played_frames / SYNTHESIZER_BLOCK_FRAMES + 1) * SYNTHESIZER_BLOCK_FRAMES;
+        int read_frames = 700;
+        if (read_frames > block_end - sound.played_frames) {
+            read_frames = block_end - sound.played_frames;
+        }
+        if (read_frames > sound.generated_frames - sound.played_frames) {
+            read_frames = sound.generated_frames - sound.played_frames;
+        }
+        const float *samples = synthesizer_sound_block(&sound, sound.played_frames);
+        mismatching_reads += memcmp(samples, expected + sound.played_frames, read_frames * sizeof(float)) != 0;
+        sound.played_frames += read_frames;
+        synthesizer_fill_blocks(&synthesizer, &sound);
+        overruns += sound.generated_frames > (sound.played_frames / SYNTHESIZER_BLOCK_FRAMES + SYNTHESIZER_AHEAD_BLOCKS) * SYNTHESIZER_BLOCK_FRAMES;
+    }
+    TEST_EQUAL_INT(mismatching_reads, 0);
+    TEST_EQUAL_INT(overruns, 0);
+    TEST_EQUAL_INT(sound.generated_frames, frame_count);
+    dyn_mem_release(expected);
+
+    synthesizer_sound_release(&synthesizer, &sound);
+    synthesizer_free_offline(&synthesizer);
+}
+
+static void test_tone_ring() {
+    printf("TEST TONE RING:\n");
+    Tone_Ring ring;
+    tone_ring_init(&ring, 5);
+    TEST_EQUAL_INT((int)ring.capacity, 8);
+    TEST_TRUE(tone_ring_front(&ring) == NULL);
+
+    int pushed = 0;
+    int popped = 0;
+    int reclaimed = 0;
+    bool is_in_order = true;
+    for (int round = 0; round < 5; round++) {
+        Synthesizer_Sound sound = {0};
+        sound.frame_count = pushed;
+        while (tone_ring_push(&ring, &sound)) {
+            pushed++;
+            sound.frame_count = pushed;
+        }
+        // played slots keep the ring full until the producer reclaims them
+        for (int i = 0; i < 3; i++) {
+            is_in_order &= tone_ring_front(&ring)->frame_count == popped;
+            tone_ring_pop(&ring);
+            popped++;
+        }
+        TEST_TRUE(!tone_ring_push(&ring, &sound));
+        while (tone_ring_reclaim(&ring) != NULL) {
+            reclaimed++;
+        }
+    }
+    TEST_TRUE(is_in_order);
+    TEST_EQUAL_INT(pushed, 8 + 4 * 3);
+    TEST_EQUAL_INT(reclaimed, popped);
+
+    tone_ring_drop_all(&ring);
+    TEST_TRUE(tone_ring_front(&ring) == NULL);
+    while (tone_ring_reclaim(&ring) != NULL) {
+        reclaimed++;
+    }
+    TEST_EQUAL_INT(reclaimed, pushed);
+    tone_ring_free(&ring);
+}
+
+static void test_tone_cache() {
+    printf("TEST TONE CACHE:\n");
+    Synthesizer synthesizer = {0};
+    synthesizer_init_offline(&synthesizer, AUDIO_FORMAT_DEFAULT);
+    Tone_Cache *cache = &synthesizer.tone_cache;
+
+    Tone tones[4] = {0};
+    for (int i = 0; i < 4; i++) {
+        tones[i].waveform = WAVEFORM_SINE;
+        tones[i].chord.size = 1;
+        tones[i].chord.frequencies[0] = i == 2 ? 330.0f : 440.0f;
+        tones[i].duration = 0.1f;
+    }
+
+    Synthesizer_Sound sounds[4];
+    synthesizer_render_tones(&synthesizer, tones, 3, sounds);
+    TEST_TRUE(sounds[0].samples == sounds[1].samples);
+    TEST_TRUE(sounds[0].samples != sounds[2].samples);
+    TEST_EQUAL_INT(sounds[0].cache_entry->ref_count, 3);
+    TEST_EQUAL_INT(cache->entry_count, 2);
+
+    synthesizer_render_tones(&synthesizer, &tones[3], 1, &sounds[3]);
+    TEST_TRUE(sounds[3].samples == sounds[0].samples);
+    TEST_EQUAL_INT((int)cache->hits, 1);
+
+    // entries still held by sounds outlive their eviction
+    tone_cache_clear(cache);
+    TEST_EQUAL_INT(cache->entry_count, 0);
+    TEST_EQUAL_INT(sounds[0].cache_entry->ref_count, 3);
+    for (int i = 0; i < 4; i++) {
+        synthesizer_sound_release(&synthesizer, &sounds[i]);
+    }
+
+    cache->max_entries = 1;
+    synthesizer_render_tones(&synthesizer, tones, 3, sounds);
+    TEST_EQUAL_INT(cache->entry_count, 1);
+    TEST_TRUE(cache->lru_head->key.frequencies[0] == 330.0f);
+    for (int i = 0; i < 3; i++) {
+        synthesizer_sound_release(&synthesizer, &sounds[i]);
+    }
+
+    synthesizer_free_offline(&synthesizer);
+}
+
+static void test_pcm_pool() {
+    printf("TEST PCM POOL:\n");
+    Synthesizer synthesizer = {0};
+    synthesizer_init_offline(&synthesizer, AUDIO_FORMAT_DEFAULT);
+    Pcm_Pool *pool = &synthesizer.tone_cache.pool;
+    synthesizer.tone_cache.max_entries = 0;
+
+    Tone tones[4] = {0};
+    for (int i = 0; i < 4; i++) {
+        tones[i].waveform = WAVEFORM_SQUARE;
+        tones[i].chord.size = 1;
+        tones[i].chord.frequencies[0] = 220.0f * (float)(i + 1);
+        tones[i].duration = 0.05f * (float)(i + 1);
+    }
+
+    Synthesizer_Sound sounds[4];
+    synthesizer_render_tones(&synthesizer, tones, 4, sounds);
+    for (int i = 0; i < 4; i++) {
+        synthesizer_sound_release(&synthesizer, &sounds[i]);
+    }
+    TEST_TRUE(pool->free_bytes > 0);
+
+    // the second batch renders into the blocks the first one gave back
+    int heap_count = dyn_mem_allocations[DYN_MEM_TAG_HEAP];
+    synthesizer_render_tones(&synthesizer, tones, 4, sounds);
+    TEST_EQUAL_INT(dyn_mem_allocations[DYN_MEM_TAG_HEAP], heap_count);
+    TEST_EQUAL_INT((int)pool->reuses, 4);
+    TEST_EQUAL_INT((int)pool->free_bytes, 0);
+
+    // past its limit the pool hands blocks back to the heap
+    pool->max_free_bytes = 0;
+    for (int i = 0; i < 4; i++) {
+        synthesizer_sound_release(&synthesizer, &sounds[i]);
+    }
+    TEST_EQUAL_INT(dyn_mem_allocations[DYN_MEM_TAG_HEAP], heap_count - 4);
+    TEST_EQUAL_INT((int)pool->free_bytes, 0);
+
+    synthesizer_free_offline(&synthesizer);
+}
+
+static void test_many_tokens() {
+    printf("TEST LEXING PAST THE INITIAL TOKEN CAPACITY:\n");
+    const char *source_line = "c4 play8 wait8";
+    int line_count = TOKEN_INITIAL_CAPACITY * 3;
+    DynArray lines;
+    dyn_array_alloc(&lines, sizeof(DynArray));
+    for (int i = 0; i < line_count; i++) {
+        DynArray line;
+        dyn_array_alloc(&line, sizeof(char));
+        for (const char *c = source_line; *c != '\0'; c++) {
+            dyn_array_push(&line, (void *)c);
+        }
+        dyn_array_push(&lines, &line);
+    }
+
+    Compiler *compiler = (Compiler *)dyn_mem_alloc_zero(sizeof(Compiler));
+    compiler_init(compiler);
+    compiler_start(compiler, &lines);
+    TEST_EQUAL_INT(compiler->error_type, NO_ERROR);
+    TEST_EQUAL_INT(compiler->token_amount, line_count * 3);
+    TEST_TRUE(compiler->token_capacity >= compiler->token_amount);
+    TEST_EQUAL_INT(compiler->tokens[compiler->token_amount - 1].type, TOKEN_WAIT);
+    TEST_EQUAL_INT(compiler->tokens[compiler->token_amount - 1].address, compiler->token_amount - 1);
+    TEST_EQUAL_INT(compiler->tones[0].waveform, WAVEFORM_SINE);
+    compiler_free(compiler);
+    dyn_mem_release(compiler);
+
+    for (int i = 0; i < lines.length; i++) {
+        dyn_array_release(dyn_array_get(&lines, i));
+    }
+    dyn_array_release(&lines);
+}
+
+static void test_symbol_table() {
+    printf("TEST SYMBOL TABLE:\n");
+    Arena arena;
+    arena_init(&arena, DYN_MEM_TAG_COMPILE, COMPILER_ARENA_CHUNK_SIZE);
+    Symbol_Table table;
+    symbol_table_init(&table, &arena);
+    char name[16];
+    int name_count = SYMBOL_TABLE_INITIAL_CAPACITY * 5;
+    bool ids_are_sequential = true;
+    for (int i = 0; i < name_count; i++) {
+        int length = sprintf(name, "name%d", i);
+        ids_are_sequential &= symbol_table_intern_hashed(&table, name, length, symbol_table_hash(name, length)) == i;
+    }
+    TEST_TRUE(ids_are_sequential);
+    TEST_EQUAL_INT(table.symbol_count, name_count);
+    bool ids_are_stable = true;
+    for (int i = 0; i < name_count; i++) {
+        int length = sprintf(name, "name%d", i);
+        ids_are_stable &= symbol_table_intern_hashed(&table, name, length, symbol_table_hash(name, length)) == i;
+    }
+    TEST_TRUE(ids_are_stable);
+    TEST_EQUAL_INT(table.symbol_count, name_count);
+    // only the given length is part of the name
+    TEST_EQUAL_INT(symbol_table_intern_hashed(&table, "name12345", 5, symbol_table_hash("name12345", 5)), 1);
+    TEST_TRUE(strcmp(symbol_table_get(&table, 7)->name, "name7") == 0);
+    arena_free(&arena);
+
+    // more defines than the old fixed limit of 255, each called once
+    int define_count = 300;
+    DynArray lines;
+    dyn_array_alloc(&lines, sizeof(DynArray));
+    for (int i = 0; i < define_count * 2; i++) {
+        char source_line[64];
+        int length = i < define_count
+            ? sprintf(source_line, "define part%d ( c4 play8 )", i)
+            : sprintf(source_line, "part%d", i - define_count);
+        DynArray line;
+        dyn_array_alloc(&line, sizeof(char));
+        for (int j = 0; j < length; j++) {
+            dyn_array_push(&line, &source_line[j]);
+        }
+        dyn_array_push(&lines, &line);
+    }
+    Compiler *compiler = (Compiler *)dyn_mem_alloc_zero(sizeof(Compiler));
+    compiler_init(compiler);
+    compiler_start(compiler, &lines);
+    TEST_EQUAL_INT(compiler->error_type, NO_ERROR);
+    TEST_EQUAL_INT(compiler->symbols.symbol_count, define_count);
+    TEST_EQUAL_INT(compiler->tone_amount, SYNTHESIZER_TONE_CAPACITY);
+    compiler_reset(compiler);
+
+    // a second define of the same name is caught without comparing strings
+    DynArray *last_line = dyn_array_get(&lines, lines.length - 1);
+    const char *redefinition = "define part0 ( c4 play8 )";
+    last_line->length = 0;
+    for (const char *c = redefinition; *c != '\0'; c++) {
+        dyn_array_push(last_line, (void *)c);
+    }
+    compiler_start(compiler, &lines);
+    TEST_EQUAL_INT(compiler->error_type, ERROR_MULTIPLE_DEFINITIONS);
+    compiler_free(compiler);
+    dyn_mem_release(compiler);
+
+    for (int i = 0; i < lines.length; i++) {
+        dyn_array_release(dyn_array_get(&lines, i));
+    }
+    dyn_array_release(&lines);
+}
+
+static void test_keywords() {
+    printf("TEST KEYWORDS:\n");
+    struct { const char *word; Token_Type type; } keywords[] = {
+        { "start", TOKEN_START }, { "sine", TOKEN_SINE }, { "triangle", TOKEN_TRIANGLE },
+        { "square", TOKEN_SQUARE }, { "sawtooth", TOKEN_SAWTOOTH }, { "semi", TOKEN_SEMI },
+        { "play", TOKEN_PLAY }, { "wait", TOKEN_WAIT }, { "bpm", TOKEN_BPM },
+        { "chord", TOKEN_CHORD }, { "scale", TOKEN_SCALE }, { "rise", TOKEN_RISE },
+        { "fall", TOKEN_FALL }, { "repeat", TOKEN_REPEAT }, { "rounds", TOKEN_ROUNDS },
+        { "forever", TOKEN_FOREVER }, { "define", TOKEN_DEFINE },
+    };
+    int keyword_count = sizeof(keywords) / sizeof(keywords[0]);
+    int recognized = 0;
+    int prefixes_rejected = 0;
+    for (int i = 0; i < keyword_count; i++) {
+        int length = strlen(keywords[i].word);
+        recognized += keyword_token_type(keywords[i].word, length) == keywords[i].type;
+        prefixes_rejected += keyword_token_type(keywords[i].word, length - 1) == TOKEN_NONE;
+    }
+    TEST_EQUAL_INT(recognized, keyword_count);
+    TEST_EQUAL_INT(prefixes_rejected, keyword_count);
+    // the word is not terminated, only its length counts
+    TEST_EQUAL_INT(keyword_token_type("plays", 4), TOKEN_PLAY);
+    TEST_EQUAL_INT(keyword_token_type("plays", 5), TOKEN_NONE);
+    TEST_EQUAL_INT(keyword_token_type("Play", 4), TOKEN_NONE);
+    TEST_EQUAL_INT(keyword_token_type("sines", 5), TOKEN_NONE);
+    TEST_EQUAL_INT(keyword_token_type("", 0), TOKEN_NONE);
+}
+
+static void test_lines_from_source(DynArray *lines, const char *source) {
+    dyn_array_alloc(lines, sizeof(DynArray));
+    while (*source != '\0') {
+        DynArray line;
+        dyn_array_alloc(&line, sizeof(char));
+        for (; *source != '\0' && *source != '\n'; source++) {
+            dyn_array_push(&line, source);
+        }
+        if (*source == '\n') {
+            source++;
+        }
+        dyn_array_push(lines, &line);
+    }
+}
+
+static void test_lines_release(DynArray *lines) {
+    for (int i = 0; i < lines->length; i++) {
+        dyn_array_release(dyn_array_get(lines, i));
+    }
+    dyn_array_release(lines);
+}
+
+// deeper than the parser's old fixed stacks of 16 repeats, 32 calls and 16 round numbers
+static void test_bytecode() {
+    printf("TEST BYTECODE:\n");
+    static char source[8192];
+    int length = 0;
+    int define_count = 40;
+    int nest_count = 100;
+    length += sprintf(source + length, "define part0 ( c4 play64 )\n");
+    for (int i = 1; i < define_count; i++) {
+        length += sprintf(source + length, "define part%d ( part%d play64 )\n", i, i - 1);
+    }
+    length += sprintf(source + length, "part%d\n", define_count - 1);
+    length += sprintf(source + length, "repeat 3 (\n");
+    for (int i = 1; i < nest_count; i++) {
+        length += sprintf(source + length, "repeat 1 (\n");
+    }
+    length += sprintf(source + length, "play64 wait64");
+    for (int i = 0; i < nest_count; i++) {
+        length += sprintf(source + length, " )");
+    }
+    length += sprintf(source + length, "\nrepeat 25 ( wait64 rounds");
+    for (int i = 1; i <= 20; i++) {
+        length += sprintf(source + length, " %d", i);
+    }
+    length += sprintf(source + length, " ( play64 ) )\n");
+
+    DynArray lines;
+    test_lines_from_source(&lines, source);
+    Compiler *compiler = (Compiler *)dyn_mem_alloc_zero(sizeof(Compiler));
+    compiler_init(compiler);
+    compiler_start(compiler, &lines);
+    TEST_EQUAL_INT(compiler->error_type, NO_ERROR);
+    Bytecode *code = &compiler->bytecode;
+    TEST_EQUAL_INT(code->instructions[code->instruction_count - 1].opcode, OP_HALT);
+    TEST_EQUAL_INT(code->round_number_count, 20);
+
+    int tone_count = compiler->tone_amount;
+    int play_count = 0;
+    while (has_flag(compiler->flags, COMPILER_FLAG_IN_PROCESS)) {
+        for (int i = 0; i < compiler->tone_amount; i++) {
+            play_count += compiler->tones[i].waveform != WAVEFORM_NONE;
+        }
+        compiler_continue(compiler);
+        tone_count += compiler->tone_amount;
+    }
+    for (int i = 0; i < compiler->tone_amount; i++) {
+        play_count += compiler->tones[i].waveform != WAVEFORM_NONE;
+    }
+    TEST_EQUAL_INT(tone_count, define_count + 3 * 2 + 25 + 20);
+    TEST_EQUAL_INT(play_count, define_count + 3 + 20);
+    TEST_EQUAL_INT(compiler->parser.loop_count, 0);
+    TEST_EQUAL_INT(compiler->parser.return_count, 0);
+    TEST_TRUE(compiler->parser.return_capacity >= define_count - 1);
+    compiler_free(compiler);
+    dyn_mem_release(compiler);
+    test_lines_release(&lines);
+}
+
+static int note_transpose_walk(int note, int scale, int direction, int steps) {
+    for (int i = 0; i < steps; i++) {
+        note += direction;
+        while (!has_flag(scale, get_note_flag(note))) {
+            note += direction;
+        }
+    }
+    return note;
+}
+
+static void test_note_tables() {
+    printf("TEST NOTE TABLES:\n");
+    note_tables_init();
+    int frequency_mismatches = 0;
+    for (int note = -128; note < 128; note++) {
+        frequency_mismatches += note_frequency((int8)note) != note_to_frequency(note);
+    }
+    TEST_EQUAL_INT(frequency_mismatches, 0);
+
+    // the walk only works while notes stay above MAX_NOTE_FROM_C0 below a4, so at most 3 octaves
+    int transpose_mismatches = 0;
+    for (int scale = 1; scale < SCALE_MASK_COUNT; scale += 13) {
+        int max_steps = 3 * scale_steps[scale].degree_count;
+        for (int note = MIN_NOTE; note <= MAX_NOTE; note++) {
+            for (int steps = 0; steps <= max_steps; steps++) {
+                transpose_mismatches += note_transpose(note, scale, 1, steps) != note_transpose_walk(note, scale, 1, steps);
+                transpose_mismatches += note_transpose(note, scale, -1, steps) != note_transpose_walk(note, scale, -1, steps);
+            }
+        }
+    }
+    TEST_EQUAL_INT(transpose_mismatches, 0);
+    TEST_EQUAL_INT(note_transpose(0, CHROMATIC_SCALE, 1, 25), 25);
+    TEST_EQUAL_INT(scale_steps[SCALE_MASK_COUNT - 1].degree_count, OCTAVE);
+}
+
+static int test_count_tones(Compiler *compiler) {
+    int tone_count = compiler->tone_amount;
+    while (has_flag(compiler->flags, COMPILER_FLAG_IN_PROCESS)) {
+        compiler_continue(compiler);
+        tone_count += compiler->tone_amount;
+    }
+    return tone_count;
+}
+
+static void test_seek() {
+    printf("TEST SEEK:\n");
+    const char *source =
+        "bpm 60 square\n"
+        "repeat 20 ( c4 play16 rise )\n"
+        "define part ( chord ( c e g ) play8 )\n"
+        "part bpm 120\n"
+        "start\n"
+        "play4 wait4\n"
+        "part\n";
+    DynArray lines;
+    test_lines_from_source(&lines, source);
+    Compiler *compiler = (Compiler *)dyn_mem_alloc_zero(sizeof(Compiler));
+    compiler_init(compiler);
+
+    // the start marker comes after more than a batch of tones, none of them is emitted
+    compiler_start(compiler, &lines);
+    TEST_EQUAL_INT(compiler->error_type, NO_ERROR);
+    TEST_EQUAL_INT(compiler->tones[0].line_idx, 5);
+    TEST_EQUAL_INT(compiler->tones[0].waveform, WAVEFORM_SQUARE);
+    TEST_EQUAL_INT(compiler->tones[0].chord.size, 3);
+    TEST_TRUE(compiler->tones[0].duration == 0.5f);
+    TEST_EQUAL_INT(test_count_tones(compiler), 3);
+    compiler_reset(compiler);
+
+    // a position before the marker plays from there instead
+    compiler_start_from(compiler, &lines, 3, 0);
+    TEST_EQUAL_INT(compiler->tones[0].line_idx, 2);
+    TEST_EQUAL_INT(compiler->tones[0].char_idx, 30);
+    TEST_EQUAL_INT(test_count_tones(compiler), 4);
+    compiler_reset(compiler);
+
+    compiler_start_from(compiler, &lines, 1, 12);
+    TEST_EQUAL_INT(test_count_tones(compiler), 20 + 1 + 2 + 1);
+    compiler_reset(compiler);
+
+    // the marker before the position does not win over it
+    compiler_start_from(compiler, &lines, 6, 0);
+    TEST_EQUAL_INT(compiler->error_type, NO_ERROR);
+    TEST_EQUAL_INT(compiler->tones[0].line_idx, 2);
+    TEST_EQUAL_INT(test_count_tones(compiler), 1);
+    compiler_reset(compiler);
+
+    // and after the last token there is nothing left to play
+    compiler_start_from(compiler, &lines, 6, 4);
+    TEST_EQUAL_INT(compiler->error_type, ERROR_NO_SOUND);
+    compiler_reset(compiler);
+    test_lines_release(&lines);
+
+    // a start in a define nothing calls or in rounds that never come up plays everything from the beginning,
+    // without running into the end or round after round of the forever loop first
+    const char *unreached_sources[] = {
+        "define nev ( start )\nplay4 play8\n",
+        "rounds 2 ( start )\nplay4 play8\n",
+        "define nev ( start )\nforever ( play16 rise )\n",
+        "rounds 2 ( start )\nforever ( play16 rise )\n",
+    };
+    for (int i = 0; i < (int)(sizeof(unreached_sources) / sizeof(unreached_sources[0])); i++) {
+        test_lines_from_source(&lines, unreached_sources[i]);
+        compiler_start(compiler, &lines);
+        TEST_EQUAL_INT(compiler->error_type, NO_ERROR);
+        TEST_EQUAL_INT(compiler->tones[0].line_idx, 1);
+        if (i < 2) {
+            TEST_EQUAL_INT(test_count_tones(compiler), 2);
+        } else {
+            TEST_EQUAL_INT(compiler->tone_amount, SYNTHESIZER_TONE_CAPACITY);
+            TEST_TRUE(compiler->parser.elapsed_seconds < 1.0);
+        }
+        compiler_reset(compiler);
+        test_lines_release(&lines);
+    }
+
+    compiler_free(compiler);
+    dyn_mem_release(compiler);
+}
+
+#define TEST_CHECKPOINT_MAX_TONES 256
+
+typedef struct Test_Timed_Tone {
+    double start_seconds;
+    Tone tone;
+} Test_Timed_Tone;
+
+// all tones from the current state to the end, with the time each one starts at
+static int test_collect_tones(Compiler *compiler, double start_seconds, Test_Timed_Tone *timed_tones) {
+    int tone_count = 0;
+    while (true) {
+        for (int i = 0; i < compiler->tone_amount && tone_count < TEST_CHECKPOINT_MAX_TONES; i++) {
+            timed_tones[tone_count].start_seconds = start_seconds;
+            timed_tones[tone_count].tone = compiler->tones[i];
+            start_seconds += compiler->tones[i].duration;
+            tone_count++;
+        }
+        if (!has_flag(compiler->flags, COMPILER_FLAG_IN_PROCESS)) {
+            return tone_count;
+        }
+        compiler_continue(compiler);
+    }
+}
+
+static void test_checkpoints() {
+    printf("TEST CHECKPOINTS:\n");
+    // 15 seconds with loops and calls open at most checkpoints
+    const char *source =
+        "bpm 240\n"
+        "define motif ( repeat 3 ( c4 play8 rise ) rounds 2 ( fall 2 ) wait8 )\n"
+        "start\n"
+        "repeat 12 ( motif sine motif square chord ( c4 e4 g4 ) play4 )\n";
+    DynArray lines;
+    test_lines_from_source(&lines, source);
+    Compiler *compiler = (Compiler *)dyn_mem_alloc_zero(sizeof(Compiler));
+    compiler_init(compiler);
+
+    static Test_Timed_Tone full[TEST_CHECKPOINT_MAX_TONES];
+    static Test_Timed_Tone seeked[TEST_CHECKPOINT_MAX_TONES];
+    compiler_start(compiler, &lines);
+    TEST_EQUAL_INT(compiler->error_type, NO_ERROR);
+    int full_count = test_collect_tones(compiler, 0.0, full);
+    TEST_EQUAL_INT(full_count, 12 * 9);
+
+    // seeking back and forth, every seek plays exactly the tail of the whole program
+    const double seek_seconds[] = { 13.1, 2.3, 9.875, 0.0, 14.75, 5.0, 4.0, 2.3 };
+    int mismatches = 0;
+    for (int i = 0; i < (int)(sizeof(seek_seconds) / sizeof(seek_seconds[0])); i++) {
+        int first = 0;
+        while (full[first].start_seconds < seek_seconds[i] - 1e-9) {
+            first++;
+        }
+        compiler_seek(compiler, seek_seconds[i]);
+        TEST_EQUAL_INT(compiler->error_type, NO_ERROR);
+        int seeked_count = test_collect_tones(compiler, full[first].start_seconds, seeked);
+        mismatches += seeked_count != full_count - first;
+        for (int j = 0; j < seeked_count && first + j < full_count; j++) {
+            Tone *expected = &full[first + j].tone;
+            Tone *actual = &seeked[j].tone;
+            mismatches +=
+                expected->line_idx != actual->line_idx ||
+                expected->char_idx != actual->char_idx ||
+                expected->waveform != actual->waveform ||
+                expected->duration != actual->duration ||
+                expected->chord.size != actual->chord.size ||
+                expected->chord.frequencies[0] != actual->chord.frequencies[0];
+        }
+    }
+    TEST_EQUAL_INT(mismatches, 0);
+    TEST_TRUE(compiler->checkpoints.count >= 4);
+
+    // past the end nothing is left to play
+    compiler_seek(compiler, 60.0);
+    TEST_EQUAL_INT(compiler->error_type, ERROR_NO_SOUND);
+    TEST_TRUE(compiler->checkpoints.is_complete);
+    compiler_reset(compiler);
+
+    compiler_free(compiler);
+    dyn_mem_release(compiler);
+    test_lines_release(&lines);
+}
+
+// the same numbers the analyzer works out, from every tone the parser emits
+static Analysis test_analysis_by_parsing(Compiler *compiler, DynArray *lines) {
+    Analysis analysis = { .length = ANALYSIS_LENGTH_FINITE };
+    long long window_bytes[SYNTHESIZER_RING_DEFAULT_DEPTH] = {0};
+    long long window_sum = 0;
+    compiler_start(compiler, lines);
+    while (true) {
+        for (int i = 0; i < compiler->tone_amount; i++) {
+            Tone *tone = &compiler->tones[i];
+            int frame_count = duration_frame_count(tone->duration, SYNTHESIZER_DEFAULT_SAMPLE_RATE);
+            long long bytes = frame_count > SYNTHESIZER_MAX_RENDERED_FRAMES ? SYNTHESIZER_AHEAD_BLOCKS * SYNTHESIZER_BLOCK_FRAMES * sizeof(float) : (long long)frame_count * sizeof(float);
+            int window_idx = analysis.tone_count % SYNTHESIZER_RING_DEFAULT_DEPTH;
+            window_sum += bytes - window_bytes[window_idx];
+            window_bytes[window_idx] = bytes;
+            if (window_sum > analysis.peak_lookahead_bytes) {
+                analysis.peak_lookahead_bytes = window_sum;
+            }
+            if (tone->waveform != WAVEFORM_NONE && tone->chord.size > analysis.max_chord_size) {
+                analysis.max_chord_size = tone->chord.size;
+            }
+            analysis.tone_count++;
+            analysis.frame_count += frame_count;
+        }
+        if (!has_flag(compiler->flags, COMPILER_FLAG_IN_PROCESS)) {
+            break;
+        }
+        compiler_continue(compiler);
+    }
+    compiler_reset(compiler);
+    return analysis;
+}
+
+static void test_analysis() {
+    printf("TEST ANALYSIS:\n");
+    Compiler *compiler = (Compiler *)dyn_mem_alloc_zero(sizeof(Compiler));
+    compiler_init(compiler);
+
+    const char *finite_sources[] = {
+        "bpm 90 c4 play4 chord ( c4 e4 g4 ) play8 wait2\n",
+        "repeat 300 ( c4 play16 rise rounds 7 150 ( bpm 200 chord ( c4 e4 ) play4 bpm 120 ) wait32 )\n",
+        "define motif ( repeat 3 ( c4 play8 ) bpm 60 )\nrepeat 100 ( motif bpm 180 repeat 50 ( play32 ) )\n",
+        "repeat 40 ( play16 ) start repeat 2 ( bpm 100 play8 bpm 150 play4 )\n",
+        "define part ( play8 rounds 2 ( chord ( c4 e4 g4 b4 ) play2 ) c4 )\nrepeat 90 ( repeat 3 ( part ) part )\n",
+        "define nev ( start )\nplay4 play8\n",
+        "rounds 2 ( start )\nplay4 play8\n",
+    };
+    int mismatches = 0;
+    for (int i = 0; i < (int)(sizeof(finite_sources) / sizeof(finite_sources[0])); i++) {
+        DynArray lines;
+        test_lines_from_source(&lines, finite_sources[i]);
+        Analysis analysis;
+        TEST_TRUE(compiler_analyze(compiler, &lines, &analysis));
+        compiler_reset(compiler);
+        Analysis expected = test_analysis_by_parsing(compiler, &lines);
+        mismatches +=
+            analysis.length != expected.length ||
+            analysis.tone_count != expected.tone_count ||
+            analysis.frame_count != expected.frame_count ||
+            analysis.max_chord_size != expected.max_chord_size ||
+            analysis.peak_lookahead_bytes != expected.peak_lookahead_bytes;
+        test_lines_release(&lines);
+    }
+    TEST_EQUAL_INT(mismatches, 0);
+
+    // far too long to play through, the repeated rounds are counted instead
+    DynArray lines;
+    test_lines_from_source(&lines, "bpm 120 repeat 9999 ( repeat 9999 ( repeat 99 ( play64 ) ) rounds 3 ( play1 ) )\n");
+    Analysis analysis;
+    TEST_TRUE(compiler_analyze(compiler, &lines, &analysis));
+    TEST_EQUAL_INT(analysis.length, ANALYSIS_LENGTH_FINITE);
+    TEST_TRUE(analysis.tone_count == 9999LL * 9999 * 99 + 1);
+    int rate = SYNTHESIZER_DEFAULT_SAMPLE_RATE;
+    TEST_TRUE(analysis.frame_count == 9999LL * 9999 * 99 * duration_frame_count(0.03125f, rate) + duration_frame_count(2.0f, rate));
+    compiler_reset(compiler);
+    test_lines_release(&lines);
+
+    // forever is reported with what comes before it and the length of one round
+    test_lines_from_source(&lines, "play4 play4\nforever ( bpm 60 play4 bpm 120 play2 )\n");
+    TEST_TRUE(compiler_analyze(compiler, &lines, &analysis));
+    TEST_EQUAL_INT(analysis.length, ANALYSIS_LENGTH_FOREVER);
+    TEST_TRUE(analysis.period_tone_count == 2);
+    TEST_TRUE(analysis.period_frame_count == 2 * rate);
+    // the first round starts at the default bpm, only the ones after it repeat
+    TEST_TRUE(analysis.tone_count == 4);
+    TEST_TRUE(analysis.frame_count == 2 * duration_frame_count(0.48f, rate) + 2 * rate);
+    compiler_reset(compiler);
+    test_lines_release(&lines);
+
+    // a start that is never reached does not hide the loop
+    const char *unreached_sources[] = {
+        "define nev ( start )\nforever ( play16 rise )\n",
+        "rounds 2 ( start )\nforever ( play16 rise )\n",
+    };
+    for (int i = 0; i < 2; i++) {
+        test_lines_from_source(&lines, unreached_sources[i]);
+        TEST_TRUE(compiler_analyze(compiler, &lines, &analysis));
+        TEST_EQUAL_INT(analysis.length, ANALYSIS_LENGTH_FOREVER);
+        TEST_TRUE(analysis.period_tone_count == 1);
+        compiler_reset(compiler);
+        test_lines_release(&lines);
+    }
+
+    test_lines_from_source(&lines, "define again ( play4 again )\nagain\n");
+    TEST_TRUE(compiler_analyze(compiler, &lines, &analysis));
+    TEST_EQUAL_INT(analysis.length, ANALYSIS_LENGTH_FOREVER);
+    TEST_TRUE(analysis.period_tone_count == 1);
+    compiler_reset(compiler);
+    test_lines_release(&lines);
+
+    compiler_free(compiler);
+    dyn_mem_release(compiler);
+}
+
+static void test_line_set(DynArray *lines, int line_idx, const char *text) {
+    DynArray *line = dyn_array_get(lines, line_idx);
+    dyn_array_clear(line);
+    for (; *text != '\0'; text++) {
+        dyn_array_push(line, (void *)text);
+    }
+}
+
+static void test_line_insert(DynArray *lines, int line_idx, const char *text) {
+    DynArray line;
+    dyn_array_alloc(&line, sizeof(char));
+    dyn_array_insert(lines, line_idx, &line, 1);
+    test_line_set(lines, line_idx, text);
+}
+
+// compiles the lines with and without the cache, the number of differences between the two
+static int test_lex_cache_mismatches(Compiler *cached, Compiler *fresh, DynArray *lines) {
+    compiler_start(cached, lines);
+    compiler_start(fresh, lines);
+    int mismatches =
+        (cached->error_type != fresh->error_type) +
+        (strcmp(cached->error_message, fresh->error_message) != 0) +
+        (cached->token_amount != fresh->token_amount);
+    for (int i = 0; i < cached->token_amount && i < fresh->token_amount; i++) {
+        Token *a = &cached->tokens[i];
+        Token *b = &fresh->tokens[i];
+        mismatches +=
+            a->type != b->type ||
+            a->address != b->address ||
+            a->line_number != b->line_number ||
+            a->char_index != b->char_index ||
+            (a->type == TOKEN_IDENTIFIER && a->value.identifier.symbol_id != b->value.identifier.symbol_id) ||
+            ((a->type == TOKEN_PLAY || a->type == TOKEN_WAIT) && (
+                a->value.play_or_wait.duration != b->value.play_or_wait.duration ||
+                a->value.play_or_wait.char_count != b->value.play_or_wait.char_count
+            )) ||
+            ((a->type == TOKEN_NUMBER || a->type == TOKEN_NOTE || a->type == TOKEN_PAREN_OPEN || a->type == TOKEN_PAREN_CLOSE) &&
+                a->value.int_number != b->value.int_number);
+    }
+    compiler_reset(cached);
+    compiler_reset(fresh);
+    return mismatches;
+}
+
+static void test_lex_cache() {
+    printf("TEST LEX CACHE:\n");
+    const char *source =
+        "bpm 120 define motif (\n"
+        "    c4 play8 rise 2 wait16\n"
+        ")\n"
+        "repeat 4 ( motif\n"
+        "    chord ( c4 e4 g4 ) play4dot )\n";
+    DynArray lines;
+    test_lines_from_source(&lines, source);
+    Lex_Cache cache = {0};
+    Compiler *cached = (Compiler *)dyn_mem_alloc_zero(sizeof(Compiler));
+    Compiler *fresh = (Compiler *)dyn_mem_alloc_zero(sizeof(Compiler));
+    compiler_init(cached);
+    compiler_init(fresh);
+    cached->lex_cache = &cache;
+
+    int mismatches = test_lex_cache_mismatches(cached, fresh, &lines);
+    TEST_EQUAL_INT(cache.line_count, lines.length);
+
+    test_line_set(&lines, 1, "    e4 play16 motif2 fall wait8");
+    lex_cache_line_changed(&cache, 1);
+    test_line_insert(&lines, 3, "define motif2 ( sine d4 play32 )");
+    lex_cache_lines_inserted(&cache, 3, 1);
+    mismatches += test_lex_cache_mismatches(cached, fresh, &lines);
+
+    // errors come out the same, also from a line that is not lexed again
+    test_line_set(&lines, 2, ") ) $");
+    lex_cache_line_changed(&cache, 2);
+    mismatches += test_lex_cache_mismatches(cached, fresh, &lines);
+    test_line_set(&lines, 0, "bpm 120 define motif ( ( ");
+    lex_cache_line_changed(&cache, 0);
+    mismatches += test_lex_cache_mismatches(cached, fresh, &lines);
+    test_line_set(&lines, 0, "bpm 120 define motif (");
+    test_line_set(&lines, 2, ")");
+    lex_cache_line_changed(&cache, 0);
+    lex_cache_line_changed(&cache, 2);
+    mismatches += test_lex_cache_mismatches(cached, fresh, &lines);
+
+    dyn_array_release(dyn_array_get(&lines, 3));
+    dyn_array_remove(&lines, 3, 1);
+    lex_cache_lines_removed(&cache, 3, 1);
+    test_line_set(&lines, 1, "    c4 play8 rise 2 wait16");
+    lex_cache_line_changed(&cache, 1);
+    mismatches += test_lex_cache_mismatches(cached, fresh, &lines);
+    TEST_EQUAL_INT(mismatches, 0);
+
+    // a line that was not reported as changed really is taken from the cache
+    test_line_set(&lines, 1, "    c4 play8 rise 2 wait16 play2");
+    TEST_TRUE(test_lex_cache_mismatches(cached, fresh, &lines) > 0);
+    lex_cache_line_changed(&cache, 1);
+    TEST_EQUAL_INT(test_lex_cache_mismatches(cached, fresh, &lines), 0);
+
+    // a cache that lost track of the lines lexes all of them again
+    test_line_insert(&lines, 0, "square");
+    TEST_EQUAL_INT(test_lex_cache_mismatches(cached, fresh, &lines), 0);
+
+    lex_cache_free(&cache);
+    compiler_free(cached);
+    compiler_free(fresh);
+    dyn_mem_release(cached);
+    dyn_mem_release(fresh);
+    test_lines_release(&lines);
+}
+
+// gives the checker thread a few seconds to publish its result for the revision
+static bool test_checker_wait(Checker *checker, uint32 revision, Checker_Result *result) {
+    for (int i = 0; i < 5000; i++) {
+        if (checker_poll(checker, result) && result->revision == revision) {
+            return true;
+        }
+        sleep_milliseconds(1);
+    }
+    return false;
+}
+
+static void test_checker_submit(Checker *checker, DynArray *lines, uint32 revision) {
+    checker_update(checker, lines, revision, 0.0f);
+    checker_update(checker, lines, revision, CHECKER_DEBOUNCE_SECONDS);
+}
+
+static void test_checker() {
+    printf("TEST CHECKER:\n");
+    const char *source =
+        "bpm 120 define motif (\n"
+        "    c4 play8 rise 2 wait16\n"
+        ")\n"
+        "repeat 4 ( motif )\n";
+    DynArray lines;
+    test_lines_from_source(&lines, source);
+    Checker *checker = (Checker *)dyn_mem_alloc_zero(sizeof(Checker));
+    checker_init(checker);
+    Checker_Result result;
+
+    // nothing is handed over before the lines stayed the same for a moment
+    checker_update(checker, &lines, 1, 0.0f);
+    checker_update(checker, &lines, 1, CHECKER_DEBOUNCE_SECONDS * 0.5f);
+    TEST_EQUAL_INT(checker->submitted_revision, 0);
+    checker_update(checker, &lines, 1, CHECKER_DEBOUNCE_SECONDS * 0.5f);
+    TEST_EQUAL_INT(checker->submitted_revision, 1);
+    TEST_TRUE(test_checker_wait(checker, 1, &result));
+    TEST_EQUAL_INT(result.error_type, NO_ERROR);
+
+    test_line_set(&lines, 3, "repeat 4 ( motif2 )");
+    test_checker_submit(checker, &lines, 2);
+    TEST_TRUE(test_checker_wait(checker, 2, &result));
+    TEST_EQUAL_INT(result.error_type, ERROR_UNKNOWN_IDENTIFIER);
+    TEST_EQUAL_INT(result.line_number, 3);
+    TEST_EQUAL_INT(result.char_idx, 11);
+
+    // lexer errors on an inserted line, the summary is the description on one line
+    test_line_set(&lines, 3, "repeat 4 ( motif )");
+    test_line_insert(&lines, 1, "    semi c4");
+    test_checker_submit(checker, &lines, 3);
+    TEST_TRUE(test_checker_wait(checker, 3, &result));
+    TEST_EQUAL_INT(result.error_type, ERROR_INVALID_SEMI);
+    TEST_EQUAL_INT(result.line_number, 1);
+    TEST_EQUAL_INT(result.char_idx, 4);
+    TEST_TRUE(strchr(result.summary, '\n') == NULL);
+
+    // of a burst of edits the last one is what stays
+    dyn_array_release(dyn_array_get(&lines, 1));
+    dyn_array_remove(&lines, 1, 1);
+    test_line_set(&lines, 0, "bpm 120 define motif ( (");
+    test_checker_submit(checker, &lines, 4);
+    test_line_set(&lines, 0, "bpm 120 define motif (");
+    test_checker_submit(checker, &lines, 5);
+    TEST_TRUE(test_checker_wait(checker, 5, &result));
+    TEST_EQUAL_INT(result.error_type, NO_ERROR);
+    TEST_EQUAL_INT(checker->lex_cache.line_count, lines.length);
+
+    checker_free(checker);
+    dyn_mem_release(checker);
+    test_lines_release(&lines);
+}
+
+static void test_arena() {
+    printf("TEST ARENA:\n");
+    int chunk_count = dyn_mem_allocations[DYN_MEM_TAG_COMPILE];
+    Arena arena;
+    arena_init(&arena, DYN_MEM_TAG_COMPILE, 1024);
+
+    char *a = (char *)arena_alloc(&arena, 3);
+    char *b = (char *)arena_alloc(&arena, 5);
+    TEST_EQUAL_INT(dyn_mem_allocations[DYN_MEM_TAG_COMPILE], chunk_count + 1);
+    TEST_EQUAL_INT((int)((size_t)a % ARENA_ALIGNMENT), 0);
+    TEST_EQUAL_INT((int)(b - a), ARENA_ALIGNMENT);
+
+    // the last allocation grows where it is, an earlier one moves and keeps what it held
+    memcpy(a, "ab", 3);
+    memcpy(b, "grow", 5);
+    TEST_TRUE(arena_grow(&arena, b, 5, 500) == b);
+    char *moved = (char *)arena_grow(&arena, a, 3, 64);
+    TEST_TRUE(moved != a);
+    TEST_TRUE(strcmp(moved, "ab") == 0);
+    TEST_TRUE(strcmp(b, "grow") == 0);
+
+    // rewinding to a mark only frees what came after it
+    Arena_Mark mark = arena_mark(&arena);
+    char *after_mark = (char *)arena_alloc(&arena, 16);
+    arena_rewind(&arena, mark);
+    TEST_TRUE(arena_alloc(&arena, 16) == after_mark);
+
+    // more than a chunk holds gets a chunk of its own
+    char *big = (char *)arena_alloc_zero(&arena, 4096);
+    TEST_EQUAL_INT(big[4095], 0);
+    TEST_EQUAL_INT(dyn_mem_allocations[DYN_MEM_TAG_COMPILE], chunk_count + 2);
+
+    // a reset keeps the chunks and starts over in the first one
+    arena_reset(&arena);
+    TEST_TRUE(arena_alloc(&arena, 3) == a);
+    TEST_TRUE(arena_alloc(&arena, 2048) == big);
+    TEST_EQUAL_INT(dyn_mem_allocations[DYN_MEM_TAG_COMPILE], chunk_count + 2);
+    arena_free(&arena);
+    TEST_EQUAL_INT(dyn_mem_allocations[DYN_MEM_TAG_COMPILE], chunk_count);
+
+    // compiling again reuses the memory of the last compile
+    DynArray lines;
+    test_lines_from_source(&lines, "define motif ( c4 play8 e4 play8 )\nrepeat 4 ( motif )\n");
+    Compiler *compiler = (Compiler *)dyn_mem_alloc_zero(sizeof(Compiler));
+    compiler_init(compiler);
+    compiler_start(compiler, &lines);
+    TEST_EQUAL_INT(compiler->error_type, NO_ERROR);
+    int heap_count = dyn_mem_allocations[DYN_MEM_TAG_HEAP];
+    int compile_count = dyn_mem_allocations[DYN_MEM_TAG_COMPILE];
+    compiler_reset(compiler);
+    compiler_start(compiler, &lines);
+    TEST_EQUAL_INT(compiler->error_type, NO_ERROR);
+    TEST_EQUAL_INT(dyn_mem_allocations[DYN_MEM_TAG_HEAP], heap_count);
+    TEST_EQUAL_INT(dyn_mem_allocations[DYN_MEM_TAG_COMPILE], compile_count);
+    compiler_free(compiler);
+    dyn_mem_release(compiler);
+    test_lines_release(&lines);
+    TEST_EQUAL_INT(dyn_mem_allocations[DYN_MEM_TAG_COMPILE], chunk_count);
+}
+
 void run_tests() {
     printf("TEST DYNAMIC ARRAY OF CHARS:\n");
-    TEST_EQUAL_INT(global_allocations, 0);
+    TEST_EQUAL_INT(dyn_mem_allocations[DYN_MEM_TAG_HEAP], 0);
 
     DynArray array = {0};
     dyn_array_alloc(&array, sizeof(char));
-    TEST_EQUAL_INT(global_allocations, 1);
+    TEST_EQUAL_INT(dyn_mem_allocations[DYN_MEM_TAG_HEAP], 1);
     TEST_EQUAL_INT(array.capacity, DYN_ARRAY_DEFAULT_CAPACITY);
     TEST_EQUAL_INT(array.element_size, sizeof(char));
     TEST_TRUE(array.data != NULL);
@@ -98,7 +1258,7 @@ void run_tests() {
     TEST_EQUAL_CHAR(c, 'b');
 
     dyn_array_clear(&array);
-    TEST_EQUAL_INT(global_allocations, 1);
+    TEST_EQUAL_INT(dyn_mem_allocations[DYN_MEM_TAG_HEAP], 1);
     TEST_TRUE(array.data != NULL);
     TEST_EQUAL_INT(array.length, 0);
     TEST_EQUAL_INT(array.capacity, DYN_ARRAY_DEFAULT_CAPACITY);
@@ -112,7 +1272,7 @@ void run_tests() {
     int x2_default_capacity = DYN_ARRAY_DEFAULT_CAPACITY * 2;
     TEST_EQUAL_INT(array.capacity, x2_default_capacity);
     TEST_EQUAL_INT(array.length, DYN_ARRAY_DEFAULT_CAPACITY + 1);
-    TEST_EQUAL_INT(global_allocations, 1);
+    TEST_EQUAL_INT(dyn_mem_allocations[DYN_MEM_TAG_HEAP], 1);
     while (array.length <= x2_default_capacity) {
         c = 'b';
         dyn_array_push(&array, &c);
@@ -139,7 +1299,7 @@ void run_tests() {
 
     DynArray array_of_arrays = {0};
     dyn_array_alloc(&array_of_arrays, sizeof(DynArray));
-    TEST_EQUAL_INT(global_allocations, 2);
+    TEST_EQUAL_INT(dyn_mem_allocations[DYN_MEM_TAG_HEAP], 2);
     TEST_EQUAL_INT(array_of_arrays.capacity, DYN_ARRAY_DEFAULT_CAPACITY);
     TEST_EQUAL_INT(array_of_arrays.element_size, sizeof(DynArray));
     TEST_TRUE(array_of_arrays.data != NULL);
@@ -148,5 +1308,25 @@ void run_tests() {
     TEST_EQUAL_INT(array_of_arrays.length, 1);
     DynArray *inner_array = dyn_array_get(&array_of_arrays, 0);
     TEST_TRUE(inner_array->data == array.data);
+
+    test_oscillators();
+    test_mix_kernels();
+    test_audio_format();
+    test_render_pool();
+    test_generated_tones();
+    test_tone_cache();
+    test_pcm_pool();
+    test_tone_ring();
+    test_many_tokens();
+    test_symbol_table();
+    test_keywords();
+    test_bytecode();
+    test_note_tables();
+    test_seek();
+    test_checkpoints();
+    test_analysis();
+    test_lex_cache();
+    test_checker();
+    test_arena();
 }
 
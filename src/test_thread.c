@@ -7,7 +7,7 @@ typedef struct Debug_Thread_Data {
 } Debug_Thread_Data;
 
 static void random_sleep() {
-    sleep(GetRandomValue(1, 100));
+    sleep_milliseconds(GetRandomValue(1, 100));
 }
 
 static void debug_mutex_function(char *id, Debug_Thread_Data *data, unsigned long add) {
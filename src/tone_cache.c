@@ -0,0 +1,200 @@
+#ifndef TONE_CACHE_C
+#define TONE_CACHE_C
+
+#include "main.h"
+#include "windows_wrapper.h"
+#include "pcm_pool.c"
+
+// silent tones all render the same, whatever their waveform, chord or sample rate
+Tone_Cache_Key tone_cache_key(Oscillator_Mode oscillator_mode, int sample_rate, Tone *tone, int frame_count) {
+    Tone_Cache_Key key;
+    memset(&key, 0, sizeof(key));
+    key.frame_count = frame_count;
+    Chord *chord = &tone->chord;
+    bool is_silent = tone->waveform == WAVEFORM_NONE || chord->size <= 0 || chord->size > OCTAVE;
+    if (is_silent) {
+        key.waveform = WAVEFORM_NONE;
+        return key;
+    }
+    key.oscillator_mode = oscillator_mode;
+    key.sample_rate = sample_rate;
+    key.waveform = tone->waveform;
+    key.chord_size = chord->size;
+    for (int i = 0; i < chord->size; i++) {
+        key.frequencies[i] = chord->frequencies[i];
+    }
+    return key;
+}
+
+static uint32 tone_cache_hash(Tone_Cache_Key *key) {
+    // FNV-1a, the key is zeroed before it is filled so padding hashes the same
+    uint32 hash = 2166136261u;
+    uint8 *bytes = (uint8 *)key;
+    for (size_t i = 0; i < sizeof(*key); i++) {
+        hash ^= bytes[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+inline static bool tone_cache_key_equals(Tone_Cache_Key *a, Tone_Cache_Key *b) {
+    return memcmp(a, b, sizeof(*a)) == 0;
+}
+
+static void tone_cache_lru_unlink(Tone_Cache *cache, Tone_Cache_Entry *entry) {
+    if (entry->lru_prev != NULL) {
+        entry->lru_prev->lru_next = entry->lru_next;
+    } else {
+        cache->lru_head = entry->lru_next;
+    }
+    if (entry->lru_next != NULL) {
+        entry->lru_next->lru_prev = entry->lru_prev;
+    } else {
+        cache->lru_tail = entry->lru_prev;
+    }
+    entry->lru_prev = NULL;
+    entry->lru_next = NULL;
+}
+
+static void tone_cache_lru_push_front(Tone_Cache *cache, Tone_Cache_Entry *entry) {
+    entry->lru_prev = NULL;
+    entry->lru_next = cache->lru_head;
+    if (cache->lru_head != NULL) {
+        cache->lru_head->lru_prev = entry;
+    } else {
+        cache->lru_tail = entry;
+    }
+    cache->lru_head = entry;
+}
+
+inline static void tone_cache_entry_unref(Tone_Cache *cache, Tone_Cache_Entry *entry) {
+    entry->ref_count--;
+    if (entry->ref_count == 0) {
+        pcm_pool_give(&cache->pool, entry, sizeof(Tone_Cache_Entry) + entry->byte_count);
+    }
+}
+
+// drops the cache's own reference, sounds still holding the entry keep its data alive
+static void tone_cache_evict(Tone_Cache *cache, Tone_Cache_Entry *entry) {
+    Tone_Cache_Entry **link = &cache->buckets[entry->hash % TONE_CACHE_BUCKETS];
+    while (*link != entry) {
+        link = &(*link)->bucket_next;
+    }
+    *link = entry->bucket_next;
+    tone_cache_lru_unlink(cache, entry);
+    cache->entry_count--;
+    cache->byte_count -= entry->byte_count;
+    cache->evictions++;
+    tone_cache_entry_unref(cache, entry);
+}
+
+void tone_cache_init(Tone_Cache *cache, int max_entries, int max_bytes) {
+    memset(cache, 0, sizeof(*cache));
+    cache->mutex = mutex_create();
+    cache->max_entries = max_entries;
+    cache->max_bytes = max_bytes;
+    pcm_pool_init(&cache->pool, PCM_POOL_DEFAULT_MAX_FREE_BYTES);
+}
+
+void tone_cache_clear(Tone_Cache *cache) {
+    mutex_lock(cache->mutex);
+        while (cache->lru_tail != NULL) {
+            tone_cache_evict(cache, cache->lru_tail);
+        }
+    mutex_unlock(cache->mutex);
+}
+
+void tone_cache_free(Tone_Cache *cache) {
+    tone_cache_clear(cache);
+    pcm_pool_free(&cache->pool);
+    mutex_destroy(cache->mutex);
+}
+
+// a hit is referenced for the caller, who has to release it again
+Tone_Cache_Entry *tone_cache_acquire(Tone_Cache *cache, Tone_Cache_Key *key) {
+    uint32 hash = tone_cache_hash(key);
+    mutex_lock(cache->mutex);
+        Tone_Cache_Entry *entry = cache->buckets[hash % TONE_CACHE_BUCKETS];
+        while (entry != NULL && !(entry->hash == hash && tone_cache_key_equals(&entry->key, key))) {
+            entry = entry->bucket_next;
+        }
+        if (entry != NULL) {
+            entry->ref_count++;
+            tone_cache_lru_unlink(cache, entry);
+            tone_cache_lru_push_front(cache, entry);
+            cache->hits++;
+        } else {
+            cache->misses++;
+        }
+    mutex_unlock(cache->mutex);
+    return entry;
+}
+
+// a new entry with room for the key's frames, referenced once for the caller and not yet visible in the cache.
+// Its block comes from the pool, where it returns once the last reference is gone
+Tone_Cache_Entry *tone_cache_entry_create(Tone_Cache *cache, Tone_Cache_Key *key) {
+    int byte_count = key->frame_count * sizeof(float);
+    mutex_lock(cache->mutex);
+        Tone_Cache_Entry *entry = (Tone_Cache_Entry *)pcm_pool_take(&cache->pool, sizeof(Tone_Cache_Entry) + byte_count);
+    mutex_unlock(cache->mutex);
+    if (entry == NULL) {
+        return NULL;
+    }
+    memset(entry, 0, sizeof(Tone_Cache_Entry));
+    entry->key = *key;
+    entry->hash = tone_cache_hash(key);
+    entry->ref_count = 1;
+    entry->byte_count = byte_count;
+    entry->samples = (float *)(entry + 1);
+    return entry;
+}
+
+// publishes a rendered entry, false when it stays private to its current holders
+bool tone_cache_insert(Tone_Cache *cache, Tone_Cache_Entry *entry) {
+    if (entry->byte_count > cache->max_bytes || cache->max_entries <= 0) {
+        return false;
+    }
+    mutex_lock(cache->mutex);
+        Tone_Cache_Entry **bucket = &cache->buckets[entry->hash % TONE_CACHE_BUCKETS];
+        Tone_Cache_Entry *existing = *bucket;
+        while (existing != NULL && !(existing->hash == entry->hash && tone_cache_key_equals(&existing->key, &entry->key))) {
+            existing = existing->bucket_next;
+        }
+        if (existing != NULL) {
+            // rendered by someone else in the meantime
+            mutex_unlock(cache->mutex);
+            return false;
+        }
+
+        while (cache->lru_tail != NULL && (
+            cache->entry_count >= cache->max_entries ||
+            cache->byte_count + entry->byte_count > cache->max_bytes
+        )) {
+            tone_cache_evict(cache, cache->lru_tail);
+        }
+
+        entry->ref_count++;
+        entry->bucket_next = *bucket;
+        *bucket = entry;
+        tone_cache_lru_push_front(cache, entry);
+        cache->entry_count++;
+        cache->byte_count += entry->byte_count;
+    mutex_unlock(cache->mutex);
+    return true;
+}
+
+void tone_cache_release(Tone_Cache *cache, Tone_Cache_Entry *entry) {
+    mutex_lock(cache->mutex);
+        tone_cache_entry_unref(cache, entry);
+    mutex_unlock(cache->mutex);
+}
+
+float tone_cache_hit_rate(Tone_Cache *cache) {
+    mutex_lock(cache->mutex);
+        long long lookups = cache->hits + cache->misses;
+        float hit_rate = lookups > 0 ? (float)cache->hits / (float)lookups : 0.0f;
+    mutex_unlock(cache->mutex);
+    return hit_rate;
+}
+
+#endif
@@ -0,0 +1,83 @@
+#ifndef TONE_RING_C
+#define TONE_RING_C
+
+#include "main.h"
+
+// head is only written by the consumer, tail and reclaimed only by the producer.
+// slots in [reclaimed, head) have been played and still hold their data until the producer releases them,
+// so the audio thread never has to free anything
+void tone_ring_init(Tone_Ring *ring, int depth) {
+    uint32 capacity = 1;
+    while (capacity < (uint32)depth) {
+        capacity <<= 1;
+    }
+    ring->slots = (Synthesizer_Sound *)dyn_mem_alloc_zero(capacity * sizeof(Synthesizer_Sound));
+    ring->capacity = capacity;
+    ring->head = 0;
+    ring->tail = 0;
+    ring->reclaimed = 0;
+}
+
+void tone_ring_free(Tone_Ring *ring) {
+    dyn_mem_release(ring->slots);
+    ring->slots = NULL;
+    ring->capacity = 0;
+}
+
+inline static Synthesizer_Sound *tone_ring_slot(Tone_Ring *ring, uint32 idx) {
+    return &ring->slots[idx & (ring->capacity - 1)];
+}
+
+// producer
+inline static uint32 tone_ring_free_slots(Tone_Ring *ring) {
+    return ring->capacity - (ring->tail - ring->reclaimed);
+}
+
+// producer
+bool tone_ring_push(Tone_Ring *ring, Synthesizer_Sound *sound) {
+    if (tone_ring_free_slots(ring) == 0) {
+        return false;
+    }
+    *tone_ring_slot(ring, ring->tail) = *sound;
+    __atomic_store_n(&ring->tail, ring->tail + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+// producer, the next played sound whose data can be released, NULL when there is none
+Synthesizer_Sound *tone_ring_reclaim(Tone_Ring *ring) {
+    if (ring->reclaimed == __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE)) {
+        return NULL;
+    }
+    Synthesizer_Sound *sound = tone_ring_slot(ring, ring->reclaimed);
+    ring->reclaimed++;
+    return sound;
+}
+
+// producer, the sound the consumer is playing, NULL when it has played everything pushed
+Synthesizer_Sound *tone_ring_playing(Tone_Ring *ring) {
+    uint32 head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+    if (head == ring->tail) {
+        return NULL;
+    }
+    return tone_ring_slot(ring, head);
+}
+
+// consumer, the sound being played, NULL when the ring is empty
+Synthesizer_Sound *tone_ring_front(Tone_Ring *ring) {
+    if (ring->head == __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE)) {
+        return NULL;
+    }
+    return tone_ring_slot(ring, ring->head);
+}
+
+// consumer
+void tone_ring_pop(Tone_Ring *ring) {
+    __atomic_store_n(&ring->head, ring->head + 1, __ATOMIC_RELEASE);
+}
+
+// only while neither side is running, marks everything queued as played so it can be reclaimed
+void tone_ring_drop_all(Tone_Ring *ring) {
+    __atomic_store_n(&ring->head, ring->tail, __ATOMIC_RELEASE);
+}
+
+#endif
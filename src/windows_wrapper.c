@@ -1,7 +1,10 @@
 #include <windows.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <process.h>
 #include <stdint.h>
+#include <fcntl.h>
+#include <io.h>
 
 #include "windows_wrapper.h"
 
@@ -31,10 +34,26 @@ void set_console_color(ConsoleColor color) {
     SetConsoleTextAttribute(console, win_color);
 }
 
-void sleep(unsigned long milliseconds) {
+void sleep_milliseconds(unsigned long milliseconds) {
     Sleep(milliseconds);
 }
 
+void thread_yield() {
+    SwitchToThread();
+}
+
+double get_time_seconds() {
+    LARGE_INTEGER frequency;
+    LARGE_INTEGER counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart / (double)frequency.QuadPart;
+}
+
+void set_stdout_binary() {
+    _setmode(_fileno(stdout), _O_BINARY);
+}
+
 int list_files(const char *dir, char *buffer, int max) {
     buffer[0] = '\0';
 
@@ -71,9 +90,32 @@ int list_files(const char *dir, char *buffer, int max) {
     return 0;
 }
 
+typedef struct Thread_Start {
+    void (*thread_function)(void *);
+    void *thread_argument;
+} Thread_Start;
+
+static unsigned __stdcall thread_start(void *data) {
+    Thread_Start start = *(Thread_Start *)data;
+    free(data);
+    start.thread_function(start.thread_argument);
+    return 0;
+}
+
+// _beginthread closes its handle when the thread exits, _beginthreadex leaves that to thread_join
 Thread thread_create(void (*thread_function)(void *), void *thread_argument) {
-    int stack_size = 0;
-    return (HANDLE)_beginthread(thread_function, stack_size, thread_argument);
+    Thread_Start *start = (Thread_Start *)malloc(sizeof(Thread_Start));
+    if (start == NULL) {
+        return NULL;
+    }
+    start->thread_function = thread_function;
+    start->thread_argument = thread_argument;
+    unsigned stack_size = 0;
+    HANDLE thread = (HANDLE)_beginthreadex(NULL, stack_size, thread_start, start, 0, NULL);
+    if (thread == NULL) {
+        free(start);
+    }
+    return thread;
 }
 
 void thread_join(Thread thread) {
@@ -82,7 +124,7 @@ void thread_join(Thread thread) {
 }
 
 void thread_error() {
-    ExitThread(1);
+    _endthreadex(1);
 }
 
 Mutex mutex_create() {
@@ -102,3 +144,42 @@ void mutex_unlock(Mutex mutex) {
 void mutex_destroy(Mutex mutex) {
     CloseHandle((HANDLE)mutex);
 }
+
+Semaphore semaphore_create(int initial_count) {
+    return CreateSemaphore(NULL, initial_count, MAXLONG, NULL);
+}
+
+void semaphore_wait(Semaphore semaphore) {
+    WaitForSingleObject((HANDLE)semaphore, INFINITE);
+}
+
+void semaphore_post(Semaphore semaphore, int count) {
+    ReleaseSemaphore((HANDLE)semaphore, count, NULL);
+}
+
+void semaphore_destroy(Semaphore semaphore) {
+    CloseHandle((HANDLE)semaphore);
+}
+
+// auto-reset, a signal with nobody waiting is kept until the next event_wait
+Event event_create() {
+    return CreateEvent(NULL, FALSE, FALSE, NULL);
+}
+
+void event_wait(Event event) {
+    WaitForSingleObject((HANDLE)event, INFINITE);
+}
+
+void event_signal(Event event) {
+    SetEvent((HANDLE)event);
+}
+
+void event_destroy(Event event) {
+    CloseHandle((HANDLE)event);
+}
+
+int get_cpu_count() {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int)info.dwNumberOfProcessors;
+}
@@ -20,9 +20,14 @@ typedef enum ConsoleColor {
 
 typedef void *Mutex;
 typedef void *Thread;
+typedef void *Semaphore;
+typedef void *Event;
 
 Keyboard_Layout get_keyboard_layout();
-void sleep(unsigned long milliseconds);
+void sleep_milliseconds(unsigned long milliseconds);
+void thread_yield();
+double get_time_seconds();
+void set_stdout_binary();
 int list_files(const char *dir, char *buffer, int max);
 Thread thread_create(void (*thread_function)(void *), void *thread_argument);
 void thread_join(Thread thread);
@@ -31,6 +36,15 @@ Mutex mutex_create();
 void mutex_lock(Mutex mutex);
 void mutex_unlock(Mutex mutex);
 void mutex_destroy(Mutex mutex);
+Semaphore semaphore_create(int initial_count);
+void semaphore_wait(Semaphore semaphore);
+void semaphore_post(Semaphore semaphore, int count);
+void semaphore_destroy(Semaphore semaphore);
+Event event_create();
+void event_wait(Event event);
+void event_signal(Event event);
+void event_destroy(Event event);
+int get_cpu_count();
 void reset_console_color();
 void set_console_color(ConsoleColor color);
 